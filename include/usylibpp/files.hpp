@@ -1,18 +1,115 @@
 #pragma once
 
 #include <string>
+#include <string_view>
+#include <span>
+#include <cstddef>
+#include <utility>
 #include <filesystem>
 #include <fstream>
 #include <optional>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <initializer_list>
+#include <new>
+#include <future>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <system_error>
+#include <unordered_set>
+#include <vector>
+#include "parallel.hpp"
+#include "strings.hpp"
+#include "unicode.hpp"
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#endif
+
+#if defined(USYLIBPP_ENABLE_IO_URING) && defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define USYLIBPP_HAS_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#else
+#define USYLIBPP_HAS_IO_URING 0
+#endif
 
 /**
  * Helper methods to do with file operations
  */
 namespace usylibpp::files {
+    #ifndef WIN32
+    namespace internal {
+        /**
+         * Reads the rest of fd into out from offset, returns false on a read error
+         */
+        [[nodiscard]] inline bool read_fd(const int fd, std::string& out, size_t offset) {
+            while (true) {
+                if (offset == out.size()) out.resize(std::max<size_t>(out.size() * 2, 4096));
+                const auto n = ::read(fd, out.data() + offset, out.size() - offset);
+                if (n < 0 && errno == EINTR) continue;
+                if (n < 0) return false;
+                if (n == 0) break;
+                offset += static_cast<size_t>(n);
+            }
+            out.resize(offset);
+            return true;
+        }
+
+        /**
+         * open, fstat and read until end of file, files whose reported size is wrong (like those in /proc) still come out whole
+         */
+        [[nodiscard]] inline std::optional<std::string> read_whole(const std::filesystem::path& path) {
+            const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd == -1) return std::nullopt;
+
+            struct stat st{};
+            std::string buffer;
+            // one byte past the size so hitting end of file does not need a second growth
+            if (fstat(fd, &st) == 0 && st.st_size > 0) buffer.resize(static_cast<size_t>(st.st_size) + 1);
+
+            const bool ok = read_fd(fd, buffer, 0);
+            close(fd);
+            if (!ok) return std::nullopt;
+            return buffer;
+        }
+
+        [[nodiscard]] inline bool write_whole(const std::filesystem::path& path, std::string_view bytes) {
+            const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+            if (fd == -1) return false;
+
+            while (!bytes.empty()) {
+                const auto n = ::write(fd, bytes.data(), bytes.size());
+                if (n < 0 && errno == EINTR) continue;
+                if (n <= 0) break;
+                bytes.remove_prefix(static_cast<size_t>(n));
+            }
+            return close(fd) == 0 && bytes.empty();
+        }
+    }
+    #endif
+
     /**
      * Read a file as bytes into a std::string
+     * On POSIX this is open, fstat and read instead of the seek / tell / read round trip through ifstream
      */
     [[nodiscard]] inline std::optional<std::string> read_as_bytes(const std::filesystem::path& path) {
+        #ifndef WIN32
+        return internal::read_whole(path);
+        #else
         std::ifstream file(path, std::ios::binary);
         if (!file) return std::nullopt;
 
@@ -27,5 +124,1403 @@ namespace usylibpp::files {
         }
 
         return buffer;
+        #endif
+    }
+
+    /**
+     * How a mapped file is expected to be read, passed on to the OS as a paging hint
+     */
+    enum class access_hint {
+        normal,
+        sequential,
+        random
+    };
+
+    /**
+     * Read only memory mapping of a whole file, pages are loaded on first access instead of copied up front
+     * Views into the file only survive as long as the mapped_file they came from
+     */
+    class mapped_file {
+    private:
+        const char* ptr = nullptr;
+        size_t length = 0;
+
+        mapped_file(const char* ptr, size_t length) noexcept : ptr(ptr), length(length) {}
+
+        void unmap() noexcept {
+            if (!ptr) return;
+            #ifdef WIN32
+            UnmapViewOfFile(ptr);
+            #else
+            munmap(const_cast<char*>(ptr), length);
+            #endif
+            ptr = nullptr;
+            length = 0;
+        }
+    public:
+        mapped_file() noexcept = default;
+
+        mapped_file(const mapped_file&) = delete;
+        mapped_file& operator=(const mapped_file&) = delete;
+
+        mapped_file(mapped_file&& other) noexcept
+            : ptr(std::exchange(other.ptr, nullptr)), length(std::exchange(other.length, 0)) {}
+
+        mapped_file& operator=(mapped_file&& other) noexcept {
+            if (this != &other) {
+                unmap();
+                ptr = std::exchange(other.ptr, nullptr);
+                length = std::exchange(other.length, 0);
+            }
+            return *this;
+        }
+
+        ~mapped_file() {
+            unmap();
+        }
+
+        /**
+         * Returns std::nullopt if the file cannot be opened or mapped
+         * Empty files map successfully to an empty view, on POSIX files that report a size of zero are read whole instead
+         */
+        [[nodiscard]] static std::optional<mapped_file> open(const std::filesystem::path& path, access_hint hint = access_hint::normal) {
+            #ifdef WIN32
+            HANDLE file = CreateFileW(
+                path.c_str(),
+                GENERIC_READ,
+                // the file can still be written, renamed or deleted by others while mapped, as on POSIX
+                FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                nullptr,
+                OPEN_EXISTING,
+                hint == access_hint::sequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_ATTRIBUTE_NORMAL,
+                nullptr
+            );
+            if (file == INVALID_HANDLE_VALUE) return std::nullopt;
+
+            LARGE_INTEGER size{};
+            if (!GetFileSizeEx(file, &size)) {
+                CloseHandle(file);
+                return std::nullopt;
+            }
+
+            if (size.QuadPart == 0) {
+                CloseHandle(file);
+                return mapped_file{};
+            }
+
+            HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            CloseHandle(file);
+            if (!mapping) return std::nullopt;
+
+            // the view keeps the mapping alive after the handle is closed
+            const void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(mapping);
+            if (!view) return std::nullopt;
+
+            return mapped_file{static_cast<const char*>(view), static_cast<size_t>(size.QuadPart)};
+            #else
+            const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd == -1) return std::nullopt;
+
+            struct stat st{};
+            if (fstat(fd, &st) != 0) {
+                close(fd);
+                return std::nullopt;
+            }
+
+            // pseudo files (like those in /proc) report a size of zero but still have contents, they cannot be mapped so they are read into anonymous memory instead
+            // for a really empty file this is a single read that returns end of file
+            if (st.st_size == 0) {
+                std::string contents;
+                const bool ok = internal::read_fd(fd, contents, 0);
+                close(fd);
+                if (!ok) return std::nullopt;
+                if (contents.empty()) return mapped_file{};
+
+                void* copy = mmap(nullptr, contents.size(), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                if (copy == MAP_FAILED) return std::nullopt;
+                std::memcpy(copy, contents.data(), contents.size());
+                mprotect(copy, contents.size(), PROT_READ);
+                return mapped_file{static_cast<const char*>(copy), contents.size()};
+            }
+
+            void* view = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            // the mapping keeps its own reference to the file
+            close(fd);
+            if (view == MAP_FAILED) return std::nullopt;
+
+            mapped_file result{static_cast<const char*>(view), static_cast<size_t>(st.st_size)};
+            result.advise(hint);
+            return result;
+            #endif
+        }
+
+        /**
+         * No-op on Windows, where the hint can only be given when opening the file
+         */
+        void advise(access_hint hint) const noexcept {
+            #ifndef WIN32
+            if (!ptr) return;
+
+            int advice = MADV_NORMAL;
+            if (hint == access_hint::sequential) advice = MADV_SEQUENTIAL;
+            else if (hint == access_hint::random) advice = MADV_RANDOM;
+
+            madvise(const_cast<char*>(ptr), length, advice);
+            #else
+            (void) hint;
+            #endif
+        }
+
+        [[nodiscard]] const char* data() const noexcept {
+            return ptr;
+        }
+
+        [[nodiscard]] size_t size() const noexcept {
+            return length;
+        }
+
+        [[nodiscard]] bool empty() const noexcept {
+            return length == 0;
+        }
+
+        [[nodiscard]] std::string_view view() const noexcept {
+            return {ptr, length};
+        }
+
+        [[nodiscard]] std::span<const std::byte> bytes() const noexcept {
+            return {reinterpret_cast<const std::byte*>(ptr), length};
+        }
+
+        operator std::string_view() const noexcept {
+            return view();
+        }
+    };
+
+    /**
+     * Reads a file in fixed size chunks and hands out views over complete records without copying them
+     * Records split across chunk boundaries are carried over, the buffer only grows for records longer than it
+     * Views only survive until the next call to next or the end of the current for_each callback
+     */
+    class line_reader {
+    private:
+        std::ifstream file;
+        std::string buffer;
+        size_t begin = 0;
+        size_t end = 0;
+        size_t scanned = 0;
+        char delimiter = '\n';
+
+        line_reader(std::ifstream&& file, char delimiter, size_t buffer_size)
+            : file(std::move(file)), buffer(buffer_size == 0 ? 1 : buffer_size, '\0'), delimiter(delimiter) {}
+
+        /**
+         * Moves the partial record to the front of the buffer and reads after it
+         * Returns false once the file is exhausted
+         */
+        bool refill() {
+            if (begin > 0) {
+                std::memmove(buffer.data(), buffer.data() + begin, end - begin);
+                end -= begin;
+                scanned -= begin;
+                begin = 0;
+            }
+            if (end == buffer.size()) buffer.resize(buffer.size() * 2);
+
+            file.read(buffer.data() + end, static_cast<std::streamsize>(buffer.size() - end));
+            const auto read = static_cast<size_t>(file.gcount());
+            end += read;
+            return read > 0;
+        }
+    public:
+        static constexpr size_t default_buffer_size = 64 * 1024;
+
+        /**
+         * Returns std::nullopt if the file cannot be opened
+         */
+        [[nodiscard]] static std::optional<line_reader> open(const std::filesystem::path& path, char delimiter = '\n', size_t buffer_size = default_buffer_size) {
+            std::ifstream file(path, std::ios::binary);
+            if (!file) return std::nullopt;
+            return line_reader{std::move(file), delimiter, buffer_size};
+        }
+
+        /**
+         * Returns std::nullopt once every record has been read
+         * A trailing delimiter does not produce an empty final record, same as strings::for_each_line
+         */
+        [[nodiscard]] std::optional<std::string_view> next() {
+            while (true) {
+                const auto* found = static_cast<const char*>(std::memchr(buffer.data() + scanned, delimiter, end - scanned));
+                if (found) {
+                    const auto pos = static_cast<size_t>(found - buffer.data());
+                    std::string_view record{buffer.data() + begin, pos - begin};
+                    begin = scanned = pos + 1;
+                    return record;
+                }
+                scanned = end;
+
+                if (!refill()) {
+                    if (begin == end) return std::nullopt;
+                    std::string_view record{buffer.data() + begin, end - begin};
+                    begin = scanned = end;
+                    return record;
+                }
+            }
+        }
+
+        /**
+         * Calls f with every remaining record, each full chunk is split in one go with strings::split_by_for_each
+         */
+        void for_each(const auto& f) {
+            while (true) {
+                const std::string_view pending{buffer.data() + begin, end - begin};
+                const auto last = pending.rfind(delimiter);
+                if (last != std::string_view::npos) {
+                    strings::split_by_for_each(pending.substr(0, last + 1), delimiter, f);
+                    begin += last + 1;
+                }
+                scanned = end;
+
+                if (!refill()) {
+                    if (begin != end) f(std::string_view{buffer.data() + begin, end - begin});
+                    begin = scanned = end;
+                    return;
+                }
+            }
+        }
+    };
+
+    /**
+     * Streams the file through f one record at a time, memory use stays at buffer_size regardless of file size
+     * Returns false if the file cannot be opened
+     */
+    [[nodiscard]] inline bool for_each_line(const std::filesystem::path& path, const auto& f, char delimiter = '\n', size_t buffer_size = line_reader::default_buffer_size) {
+        auto reader = line_reader::open(path, delimiter, buffer_size);
+        if (!reader) return false;
+        reader->for_each(f);
+        return true;
+    }
+
+    /**
+     * Validates the file as UTF-8 while reading it in buffer_size chunks, stops reading at the first error
+     * Returns std::nullopt if the file cannot be opened
+     */
+    [[nodiscard]] inline std::optional<unicode::validation_result> validate_utf8(const std::filesystem::path& path, size_t buffer_size = line_reader::default_buffer_size) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) return std::nullopt;
+
+        std::string buffer(buffer_size == 0 ? 1 : buffer_size, '\0');
+        unicode::utf8_validator validator;
+        while (file) {
+            file.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            const auto read = static_cast<size_t>(file.gcount());
+            if (read == 0 || !validator.feed({buffer.data(), read})) break;
+        }
+        return validator.finish();
     }
-}
\ No newline at end of file
+
+    namespace internal {
+        [[nodiscard]] inline size_t worker_count(const size_t thread_count, const size_t work) noexcept {
+            const size_t threads = thread_count == 0 ? std::max(1u, std::thread::hardware_concurrency()) : thread_count;
+            return std::max<size_t>(1, std::min(threads, work));
+        }
+
+        /**
+         * Runs count copies of worker on the default parallel pool, the calling thread being one of them
+         */
+        inline void run_workers(const size_t count, const auto& worker) {
+            parallel::task_group group;
+            for (size_t i = 1; i < count; ++i) group.run(worker);
+            worker();
+            group.wait();
+        }
+    }
+
+    /**
+     * Lists everything under root on thread_count threads (0 for std::thread::hardware_concurrency), idle threads take the next unlisted directory
+     * filter(const std::filesystem::directory_entry&) is asked about every entry, rejected directories are not descended into
+     * callback(const std::filesystem::directory_entry&) gets every accepted entry, directories included
+     * Both are called concurrently in no particular order, so they have to be thread safe
+     * The first exception thrown by either stops the walk and is rethrown once every thread has finished
+     * Symlinked directories are reported but not followed, unreadable directories are skipped
+     * Returns false if root is not a directory
+     */
+    inline bool walk(const std::filesystem::path& root, const auto& filter, const auto& callback, const size_t thread_count = 0) {
+        std::error_code ec;
+        if (!std::filesystem::is_directory(root, ec)) return false;
+
+        const auto limit = internal::worker_count(thread_count, std::numeric_limits<size_t>::max());
+        std::mutex mutex;
+        std::vector<std::filesystem::path> pending{root};
+        size_t active = 1;
+        std::atomic<bool> stopping = false;
+        parallel::task_group group;
+
+        // a worker lists directories until none are queued and then goes back to the pool, workers that find more than they can list start new ones
+        const auto worker = [&](const auto& self) -> void {
+            std::vector<std::filesystem::path> found;
+            while (true) {
+                std::filesystem::path directory;
+                {
+                    std::lock_guard lock{mutex};
+                    if (pending.empty() || stopping.load(std::memory_order_relaxed)) {
+                        --active;
+                        return;
+                    }
+                    directory = std::move(pending.back());
+                    pending.pop_back();
+                }
+
+                found.clear();
+                try {
+                    std::error_code list_ec;
+                    for (std::filesystem::directory_iterator it{directory, std::filesystem::directory_options::skip_permission_denied, list_ec}, end; !list_ec && it != end; it.increment(list_ec)) {
+                        if (stopping.load(std::memory_order_relaxed)) break;
+                        const auto& entry = *it;
+                        if (!filter(entry)) continue;
+                        callback(entry);
+
+                        std::error_code type_ec;
+                        if (entry.is_directory(type_ec) && !entry.is_symlink(type_ec)) found.push_back(entry.path());
+                    }
+                } catch (...) {
+                    // the group keeps the exception for wait, everyone else stops at their next entry
+                    stopping.store(true, std::memory_order_relaxed);
+                    std::lock_guard lock{mutex};
+                    --active;
+                    throw;
+                }
+
+                size_t spawn = 0;
+                {
+                    std::lock_guard lock{mutex};
+                    pending.insert(pending.end(), std::make_move_iterator(found.begin()), std::make_move_iterator(found.end()));
+                    // this worker takes one of the queued directories itself
+                    if (pending.size() > 1) spawn = std::min(limit - active, pending.size() - 1);
+                    active += spawn;
+                }
+                for (size_t i = 0; i < spawn; ++i) group.run([&self] { self(self); });
+            }
+        };
+
+        group.run([&worker] { worker(worker); });
+        group.wait();
+        return true;
+    }
+
+    /**
+     * Contents of many files in one contiguous buffer, indexed in the order the paths were given
+     */
+    class file_batch {
+    private:
+        std::unique_ptr<char[]> buffer;
+        size_t total = 0;
+        std::vector<size_t> offsets;
+        std::vector<size_t> lengths;
+        std::vector<bool> ok;
+
+        friend file_batch read_many(std::span<const std::filesystem::path>, size_t);
+    public:
+        [[nodiscard]] size_t size() const noexcept {
+            return offsets.size();
+        }
+
+        [[nodiscard]] bool empty() const noexcept {
+            return offsets.empty();
+        }
+
+        /**
+         * Empty for files that could not be read
+         */
+        [[nodiscard]] std::string_view operator[](const size_t i) const noexcept {
+            return {buffer.get() + offsets[i], lengths[i]};
+        }
+
+        /**
+         * False if the file could not be opened or read
+         */
+        [[nodiscard]] bool loaded(const size_t i) const noexcept {
+            return ok[i];
+        }
+
+        /**
+         * Every file back to back, a file that shrank while being read leaves unspecified bytes after its contents
+         */
+        [[nodiscard]] std::string_view data() const noexcept {
+            return {buffer.get(), total};
+        }
+    };
+
+    /**
+     * Loads every file on thread_count threads (0 for std::thread::hardware_concurrency) into a single allocation
+     * Sizes are taken first so the buffer is allocated once, then each thread opens, reads and closes its share of files
+     * with at most one descriptor open per thread, a file that grew in between is cut at its earlier size
+     * Files that report a size of zero (like those in /proc) are read whole with read_as_bytes while sizes are taken,
+     * so they come out complete as they do from read_as_bytes
+     */
+    [[nodiscard]] inline file_batch read_many(const std::span<const std::filesystem::path> paths, const size_t thread_count = 0) {
+        // files are handed out in blocks so threads do not fight over the counter
+        constexpr size_t block = 16;
+
+        file_batch batch;
+        batch.offsets.resize(paths.size());
+        batch.lengths.resize(paths.size());
+        batch.ok.assign(paths.size(), false);
+
+        const auto workers = internal::worker_count(thread_count, (paths.size() + block - 1) / block);
+        const auto for_each_file = [&](const auto& f) {
+            std::atomic<size_t> next{0};
+            internal::run_workers(workers, [&] {
+                for (auto first = next.fetch_add(block); first < paths.size(); first = next.fetch_add(block)) {
+                    for (auto i = first; i < std::min(first + block, paths.size()); ++i) f(i);
+                }
+            });
+        };
+
+        std::vector<size_t> sizes(paths.size(), 0);
+        std::vector<uint8_t> found(paths.size(), 0);
+        std::vector<std::optional<std::string>> unsized(paths.size());
+        for_each_file([&](const size_t i) {
+            std::error_code ec;
+            const auto size = std::filesystem::file_size(paths[i], ec);
+            if (ec) return;
+            if (size == 0) {
+                // nothing to size the buffer by, so the whole contents are fetched now and copied in below
+                unsized[i] = read_as_bytes(paths[i]);
+                if (!unsized[i]) return;
+                sizes[i] = unsized[i]->size();
+            } else {
+                sizes[i] = static_cast<size_t>(size);
+            }
+            found[i] = 1;
+        });
+
+        for (size_t i = 0; i < paths.size(); ++i) {
+            batch.offsets[i] = batch.total;
+            batch.total += sizes[i];
+        }
+        // left uninitialised, zero filling would touch every page once more before the reads do
+        batch.buffer = std::make_unique_for_overwrite<char[]>(batch.total);
+
+        std::vector<uint8_t> loaded(paths.size(), 0);
+        for_each_file([&](const size_t i) {
+            if (!found[i]) return;
+            char* dest = batch.buffer.get() + batch.offsets[i];
+            size_t read = 0;
+
+            if (unsized[i]) {
+                std::memcpy(dest, unsized[i]->data(), unsized[i]->size());
+                batch.lengths[i] = unsized[i]->size();
+                loaded[i] = 1;
+                return;
+            }
+
+            #ifdef WIN32
+            std::ifstream file(paths[i], std::ios::binary);
+            if (!file) return;
+            file.read(dest, static_cast<std::streamsize>(sizes[i]));
+            read = static_cast<size_t>(file.gcount());
+            #else
+            const int fd = ::open(paths[i].c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd == -1) return;
+            while (read < sizes[i]) {
+                const auto n = pread(fd, dest + read, sizes[i] - read, static_cast<off_t>(read));
+                if (n < 0 && errno == EINTR) continue;
+                if (n <= 0) break;
+                read += static_cast<size_t>(n);
+            }
+            close(fd);
+            #endif
+
+            batch.lengths[i] = read;
+            loaded[i] = 1;
+        });
+
+        for (size_t i = 0; i < paths.size(); ++i) batch.ok[i] = loaded[i] != 0;
+        return batch;
+    }
+
+    namespace internal {
+        #ifdef WIN32
+        [[nodiscard]] inline bool write_whole(const std::filesystem::path& path, const std::string_view bytes) {
+            std::ofstream file(path, std::ios::binary | std::ios::trunc);
+            if (!file) return false;
+            file.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+            file.close();
+            return !file.fail();
+        }
+        #endif
+
+        /**
+         * Blocking file calls where io_uring is not available, they spend most of their time waiting so there are more threads than cores
+         */
+        [[nodiscard]] inline parallel::thread_pool& io_pool() {
+            static parallel::thread_pool pool{{.threads = std::max(4u, std::thread::hardware_concurrency())}};
+            return pool;
+        }
+
+        #if USYLIBPP_HAS_IO_URING
+        /**
+         * Minimal io_uring driven through the raw syscalls so there is no liburing dependency
+         * Callers open and fstat on their own thread and queue the read or write, one completion thread reaps results,
+         * resubmits short transfers and fulfils the promises
+         */
+        class uring {
+        private:
+            struct request {
+                int fd = -1;
+                bool is_write = false;
+                std::string buffer;
+                size_t done = 0;
+                std::promise<std::optional<std::string>> read_result;
+                std::promise<bool> write_result;
+            };
+
+            int ring_fd = -1;
+            unsigned entries = 0;
+            unsigned* sq_tail = nullptr;
+            unsigned* sq_mask = nullptr;
+            unsigned* sq_array = nullptr;
+            io_uring_sqe* sqes = nullptr;
+            unsigned* cq_head = nullptr;
+            unsigned* cq_tail = nullptr;
+            unsigned* cq_mask = nullptr;
+            io_uring_cqe* cqes = nullptr;
+            void* sq_ring = MAP_FAILED;
+            size_t sq_ring_size = 0;
+            void* cq_ring = MAP_FAILED;
+            size_t cq_ring_size = 0;
+            size_t sqes_size = 0;
+
+            std::mutex submit_mutex;
+            std::condition_variable room;
+            size_t in_flight = 0;
+            size_t pending_sqes = 0;
+            // every request queued on the ring, so a ring that stops working can still fail their futures
+            std::unordered_set<request*> live;
+            int failure = 0;
+            std::atomic<bool> broken = false;
+            std::atomic<bool> reaping = false;
+            std::jthread reaper;
+
+            [[nodiscard]] static int enter(const int fd, const unsigned to_submit, const unsigned min_complete, const unsigned flags) noexcept {
+                return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+            }
+
+            /**
+             * Needs submit_mutex, the sqe is only handed to the kernel by flush
+             */
+            void queue(request* req) noexcept {
+                const auto tail = *sq_tail;
+                const auto index = tail & *sq_mask;
+                auto& sqe = sqes[index];
+                std::memset(&sqe, 0, sizeof(sqe));
+                sqe.opcode = req->is_write ? IORING_OP_WRITE : IORING_OP_READ;
+                sqe.fd = req->fd;
+                sqe.addr = reinterpret_cast<uint64_t>(req->buffer.data() + req->done);
+                sqe.len = static_cast<uint32_t>(std::min<size_t>(req->buffer.size() - req->done, 1u << 30));
+                sqe.off = req->done;
+                sqe.user_data = reinterpret_cast<uint64_t>(req);
+                sq_array[index] = index;
+                std::atomic_ref{*sq_tail}.store(tail + 1, std::memory_order_release);
+                ++pending_sqes;
+            }
+
+            /**
+             * The future throws std::system_error with the errno that broke the ring
+             */
+            static void fail(request* req, const int error) {
+                close(req->fd);
+                const auto exception = std::make_exception_ptr(std::system_error(error, std::generic_category(), "io_uring_enter"));
+                if (req->is_write) req->write_result.set_exception(exception);
+                else req->read_result.set_exception(exception);
+            }
+
+            /**
+             * Needs submit_mutex, the ring is not used for anything new once this is called
+             */
+            void mark_broken(const int error) noexcept {
+                if (!failure) failure = error;
+                broken.store(true, std::memory_order_relaxed);
+                room.notify_all();
+            }
+
+            /**
+             * Needs submit_mutex, one syscall for everything queued since the last flush
+             * Returns false if the kernel refused the submission, the requests it did not take are failed
+             */
+            bool flush() {
+                while (pending_sqes > 0) {
+                    const auto submitted = enter(ring_fd, static_cast<unsigned>(pending_sqes), 0, 0);
+                    if (submitted >= 0) {
+                        pending_sqes -= static_cast<size_t>(submitted);
+                        continue;
+                    }
+                    if (errno == EINTR || errno == EAGAIN || errno == EBUSY) continue;
+
+                    // the kernel has not looked at the last pending_sqes entries, take them back so nothing waits on them
+                    const auto error = errno;
+                    auto tail = *sq_tail;
+                    for (; pending_sqes > 0; --pending_sqes) {
+                        --tail;
+                        auto* req = reinterpret_cast<request*>(sqes[tail & *sq_mask].user_data);
+                        if (!req) continue;
+                        live.erase(req);
+                        fail(req, error);
+                        delete req;
+                        --in_flight;
+                    }
+                    std::atomic_ref{*sq_tail}.store(tail, std::memory_order_release);
+                    mark_broken(error);
+                    return false;
+                }
+                return true;
+            }
+
+            void finish(request* req, const bool ok) {
+                close(req->fd);
+                if (req->is_write) {
+                    req->write_result.set_value(ok);
+                } else if (ok) {
+                    req->buffer.resize(req->done);
+                    req->read_result.set_value(std::move(req->buffer));
+                } else {
+                    req->read_result.set_value(std::nullopt);
+                }
+
+                {
+                    std::lock_guard lock{submit_mutex};
+                    live.erase(req);
+                    --in_flight;
+                    room.notify_all();
+                }
+                delete req;
+            }
+
+            /**
+             * Completions can no longer be waited for, every request still queued gets the error
+             * Their buffers are left alone since the kernel may still write into them
+             */
+            void fail_all(const int error) {
+                std::lock_guard lock{submit_mutex};
+                for (auto* req : live) fail(req, error);
+                in_flight -= live.size();
+                live.clear();
+                mark_broken(error);
+            }
+
+            void complete(request* req, const int result) {
+                if (result == -EINTR || result == -EAGAIN) {
+                    // same request again, it already holds its in_flight slot
+                } else if (result < 0) {
+                    finish(req, false);
+                    return;
+                } else if (result == 0) {
+                    // the file shrank after fstat, writes never return 0 for a non empty buffer
+                    finish(req, !req->is_write);
+                    return;
+                } else {
+                    req->done += static_cast<size_t>(result);
+                    if (req->done == req->buffer.size()) {
+                        finish(req, true);
+                        return;
+                    }
+                }
+
+                std::lock_guard lock{submit_mutex};
+                queue(req);
+                flush();
+            }
+
+            void reap() {
+                while (true) {
+                    if (enter(ring_fd, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) {
+                        fail_all(errno);
+                        reaping.store(false, std::memory_order_relaxed);
+                        return;
+                    }
+
+                    auto head = *cq_head;
+                    const auto tail = std::atomic_ref{*cq_tail}.load(std::memory_order_acquire);
+                    bool stop = false;
+                    for (; head != tail; ++head) {
+                        const auto& cqe = cqes[head & *cq_mask];
+                        if (cqe.user_data == 0) stop = true;
+                        else complete(reinterpret_cast<request*>(cqe.user_data), cqe.res);
+                    }
+                    std::atomic_ref{*cq_head}.store(head, std::memory_order_release);
+                    if (stop) {
+                        reaping.store(false, std::memory_order_relaxed);
+                        return;
+                    }
+                }
+            }
+
+            /**
+             * Waits while as many requests are in flight as the completion queue can hold, so it never overflows
+             * This also caps the number of descriptors a large batch keeps open
+             */
+            void reserve() {
+                std::unique_lock lock{submit_mutex};
+                // slots held by queued but unsubmitted requests would otherwise never free up
+                if (in_flight >= entries) flush();
+                room.wait(lock, [&] { return in_flight < entries; });
+                ++in_flight;
+            }
+
+            void unreserve() {
+                std::lock_guard lock{submit_mutex};
+                --in_flight;
+                room.notify_all();
+            }
+
+            void add(request* req, const bool submit) {
+                std::lock_guard lock{submit_mutex};
+                if (broken.load(std::memory_order_relaxed)) {
+                    fail(req, failure);
+                    delete req;
+                    --in_flight;
+                    room.notify_all();
+                    return;
+                }
+                live.insert(req);
+                queue(req);
+                if (submit || pending_sqes == entries) flush();
+            }
+
+            /**
+             * IORING_OP_READ and IORING_OP_WRITE came in 5.6 together with IORING_REGISTER_PROBE, so a kernel without the probe has neither
+             */
+            [[nodiscard]] bool supports_read_write() const noexcept {
+                constexpr unsigned op_count = 256;
+                alignas(io_uring_probe) unsigned char memory[sizeof(io_uring_probe) + op_count * sizeof(io_uring_probe_op)]{};
+                auto* probe = reinterpret_cast<io_uring_probe*>(memory);
+                if (syscall(__NR_io_uring_register, ring_fd, IORING_REGISTER_PROBE, probe, op_count) < 0) return false;
+
+                const auto supported = [&](const unsigned op) {
+                    return op <= probe->last_op && (probe->ops[op].flags & IO_URING_OP_SUPPORTED);
+                };
+                return supported(IORING_OP_READ) && supported(IORING_OP_WRITE);
+            }
+
+            [[nodiscard]] static request* open_read(const std::filesystem::path& path, std::future<std::optional<std::string>>& future) {
+                auto* req = new request{};
+                future = req->read_result.get_future();
+                req->fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+                struct stat st{};
+                if (req->fd == -1 || fstat(req->fd, &st) != 0 || st.st_size == 0) {
+                    // unknown sizes are read the blocking way instead of guessing a buffer
+                    if (req->fd != -1) close(req->fd);
+                    req->read_result.set_value(req->fd == -1 ? std::nullopt : read_whole(path));
+                    delete req;
+                    return nullptr;
+                }
+                req->buffer.resize(static_cast<size_t>(st.st_size));
+                return req;
+            }
+        public:
+            explicit uring(const unsigned queue_entries) {
+                io_uring_params params{};
+                ring_fd = static_cast<int>(syscall(__NR_io_uring_setup, queue_entries, &params));
+                if (ring_fd < 0) return;
+                if (!supports_read_write()) {
+                    release();
+                    return;
+                }
+                entries = params.sq_entries;
+
+                sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+                cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+                const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+                if (single_mmap) sq_ring_size = cq_ring_size = std::max(sq_ring_size, cq_ring_size);
+
+                sq_ring = mmap(nullptr, sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+                cq_ring = single_mmap ? sq_ring : mmap(nullptr, cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+                sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+                void* sqe_memory = mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+                if (sq_ring == MAP_FAILED || cq_ring == MAP_FAILED || sqe_memory == MAP_FAILED) {
+                    if (sqe_memory != MAP_FAILED) munmap(sqe_memory, sqes_size);
+                    release();
+                    return;
+                }
+
+                auto* sq = static_cast<char*>(sq_ring);
+                auto* cq = static_cast<char*>(cq_ring);
+                sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+                sq_mask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+                sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+                sqes = static_cast<io_uring_sqe*>(sqe_memory);
+                cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+                cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+                cq_mask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+                cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+                reaping.store(true, std::memory_order_relaxed);
+                reaper = std::jthread{[this] { reap(); }};
+            }
+
+            uring(const uring&) = delete;
+            uring& operator=(const uring&) = delete;
+
+            /**
+             * Waits for every request in flight, then wakes the completion thread with a no-op so it exits
+             */
+            ~uring() {
+                if (ring_fd < 0) return;
+                bool woken = true;
+                {
+                    std::unique_lock lock{submit_mutex};
+                    room.wait(lock, [&] { return in_flight == 0; });
+                    if (reaping.load(std::memory_order_relaxed)) {
+                        const auto tail = *sq_tail;
+                        const auto index = tail & *sq_mask;
+                        std::memset(&sqes[index], 0, sizeof(io_uring_sqe));
+                        sqes[index].opcode = IORING_OP_NOP;
+                        sq_array[index] = index;
+                        std::atomic_ref{*sq_tail}.store(tail + 1, std::memory_order_release);
+                        ++pending_sqes;
+                        woken = flush();
+                    }
+                }
+                if (!woken) {
+                    // the completion thread is stuck in the kernel on a ring that refuses submissions, it and its mappings are left to process exit
+                    reaper.detach();
+                    return;
+                }
+                reaper.join();
+                release();
+            }
+
+            void release() noexcept {
+                if (sqes) munmap(sqes, sqes_size);
+                if (cq_ring != MAP_FAILED && cq_ring != sq_ring) munmap(cq_ring, cq_ring_size);
+                if (sq_ring != MAP_FAILED) munmap(sq_ring, sq_ring_size);
+                sqes = nullptr;
+                cq_ring = sq_ring = MAP_FAILED;
+                if (ring_fd >= 0) close(ring_fd);
+                ring_fd = -1;
+            }
+
+            [[nodiscard]] bool ready() const noexcept {
+                return ring_fd >= 0 && !broken.load(std::memory_order_relaxed);
+            }
+
+            /**
+             * nullptr if the kernel refuses io_uring (too old, without IORING_OP_READ / IORING_OP_WRITE, or blocked by a seccomp policy)
+             * or the ring stopped working, callers then fall back to io_pool
+             */
+            [[nodiscard]] static uring* instance() {
+                static uring ring{256};
+                return ring.ready() ? &ring : nullptr;
+            }
+
+            [[nodiscard]] std::vector<std::future<std::optional<std::string>>> read(const std::span<const std::filesystem::path> paths) {
+                std::vector<std::future<std::optional<std::string>>> futures(paths.size());
+                for (size_t i = 0; i < paths.size(); ++i) {
+                    reserve();
+                    if (auto* req = open_read(paths[i], futures[i])) add(req, i + 1 == paths.size());
+                    else unreserve();
+                }
+
+                std::lock_guard lock{submit_mutex};
+                flush();
+                return futures;
+            }
+
+            [[nodiscard]] std::future<bool> write(const std::filesystem::path& path, std::string&& bytes) {
+                auto* req = new request{};
+                req->is_write = true;
+                auto future = req->write_result.get_future();
+
+                reserve();
+                req->fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+                if (req->fd == -1 || bytes.empty()) {
+                    req->write_result.set_value(req->fd != -1 && close(req->fd) == 0);
+                    delete req;
+                    unreserve();
+                    return future;
+                }
+                req->buffer = std::move(bytes);
+                add(req, true);
+                return future;
+            }
+        };
+        #endif
+    }
+
+    /**
+     * Reads a whole file without blocking the caller, the future holds std::nullopt if it cannot be read
+     * Runs on io_uring when built with USYLIBPP_ENABLE_IO_URING and the kernel allows it, on a small thread pool otherwise
+     */
+    [[nodiscard]] inline std::future<std::optional<std::string>> async_read(const std::filesystem::path& path) {
+        #if USYLIBPP_HAS_IO_URING
+        if (auto* ring = internal::uring::instance()) return std::move(ring->read({&path, 1})[0]);
+        #endif
+        return internal::io_pool().submit([path] { return read_as_bytes(path); });
+    }
+
+    /**
+     * Batched form of async_read, with io_uring every read goes to the kernel in one submission
+     */
+    [[nodiscard]] inline std::vector<std::future<std::optional<std::string>>> async_read(const std::span<const std::filesystem::path> paths) {
+        #if USYLIBPP_HAS_IO_URING
+        if (auto* ring = internal::uring::instance()) return ring->read(paths);
+        #endif
+        std::vector<std::future<std::optional<std::string>>> futures;
+        futures.reserve(paths.size());
+        for (const auto& path : paths) futures.push_back(internal::io_pool().submit([path] { return read_as_bytes(path); }));
+        return futures;
+    }
+
+    /**
+     * Replaces the file with bytes without blocking the caller, the future holds false if anything failed
+     * bytes is moved in so it stays alive until the write is done
+     */
+    [[nodiscard]] inline std::future<bool> async_write(const std::filesystem::path& path, std::string bytes) {
+        #if USYLIBPP_HAS_IO_URING
+        if (auto* ring = internal::uring::instance()) return ring->write(path, std::move(bytes));
+        #endif
+        return internal::io_pool().submit([path, bytes = std::move(bytes)] { return internal::write_whole(path, bytes); });
+    }
+
+    /**
+     * How far write_atomic and writer::sync push data before returning
+     * data flushes the contents (fdatasync), full also flushes metadata like timestamps (fsync)
+     */
+    enum class sync_mode {
+        none,
+        data,
+        full
+    };
+
+    namespace internal {
+        /**
+         * Follows path through any chain of symlinks, the last link may dangle, gives up after 40 hops like the kernel does
+         */
+        [[nodiscard]] inline std::filesystem::path resolve_symlinks(std::filesystem::path path) {
+            std::error_code ec;
+            for (int hops = 0; hops < 40 && std::filesystem::is_symlink(path, ec); ++hops) {
+                auto link = std::filesystem::read_symlink(path, ec);
+                if (ec) break;
+                path = link.is_absolute() ? std::move(link) : path.parent_path() / link;
+            }
+            return path;
+        }
+
+        [[nodiscard]] inline std::filesystem::path temp_sibling(const std::filesystem::path& path) {
+            static std::atomic<uint64_t> counter{0};
+            #ifdef WIN32
+            const auto process = static_cast<uint64_t>(GetCurrentProcessId());
+            #else
+            const auto process = static_cast<uint64_t>(getpid());
+            #endif
+            auto name = strings::concat_strings(".", path.filename().string(), ".", *strings::to_string_view(process), ".", *strings::to_string_view(counter.fetch_add(1, std::memory_order_relaxed)), ".tmp");
+            return path.parent_path() / name;
+        }
+
+        #ifndef WIN32
+        [[nodiscard]] inline bool sync_fd(const int fd, const sync_mode mode) noexcept {
+            if (mode == sync_mode::none) return true;
+            #ifdef __APPLE__
+            return fcntl(fd, F_FULLFSYNC) == 0 || fsync(fd) == 0;
+            #else
+            return (mode == sync_mode::data ? fdatasync(fd) : fsync(fd)) == 0;
+            #endif
+        }
+
+        [[nodiscard]] inline bool write_all(const int fd, std::string_view bytes) noexcept {
+            while (!bytes.empty()) {
+                const auto n = ::write(fd, bytes.data(), bytes.size());
+                if (n < 0 && errno == EINTR) continue;
+                if (n <= 0) return false;
+                bytes.remove_prefix(static_cast<size_t>(n));
+            }
+            return true;
+        }
+        #endif
+    }
+
+    /**
+     * Replaces path with bytes so readers see either the old or the new contents, never a partial file
+     * Writes a temporary file next to path, flushes it as asked by sync, then renames it over path
+     * With sync other than none the directory entry is flushed too, so the rename itself survives a crash
+     * On POSIX an existing file keeps its permission bits, a new one gets 0666 minus the umask
+     * Symlinks are followed, the file at the end of the chain is replaced and the links stay as they are
+     */
+    [[nodiscard]] inline bool write_atomic(const std::filesystem::path& path, const std::string_view bytes, const sync_mode sync = sync_mode::data) {
+        // renaming over a symlink would replace the link itself, the file it points to is what gets replaced instead
+        const auto target = internal::resolve_symlinks(path);
+        const auto temp = internal::temp_sibling(target);
+
+        #ifdef WIN32
+        HANDLE file = CreateFileW(temp.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_NEW, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return false;
+
+        bool ok = true;
+        for (auto rest = bytes; ok && !rest.empty();) {
+            DWORD written = 0;
+            ok = WriteFile(file, rest.data(), static_cast<DWORD>(std::min<size_t>(rest.size(), 1u << 30)), &written, nullptr) && written > 0;
+            rest.remove_prefix(written);
+        }
+        if (ok && sync != sync_mode::none) ok = FlushFileBuffers(file);
+        ok = CloseHandle(file) && ok;
+
+        if (ok) ok = MoveFileExW(temp.c_str(), target.c_str(), MOVEFILE_REPLACE_EXISTING | (sync != sync_mode::none ? MOVEFILE_WRITE_THROUGH : 0));
+        if (!ok) DeleteFileW(temp.c_str());
+        return ok;
+        #else
+        const int fd = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
+        if (fd == -1) return false;
+
+        // the rename replaces the inode, so an existing file's permission bits have to be carried over by hand
+        bool ok = true;
+        struct stat existing{};
+        if (stat(target.c_str(), &existing) == 0) ok = fchmod(fd, existing.st_mode & 07777) == 0;
+
+        ok = ok && internal::write_all(fd, bytes) && internal::sync_fd(fd, sync);
+        ok = close(fd) == 0 && ok;
+        if (ok) ok = std::rename(temp.c_str(), target.c_str()) == 0;
+        if (!ok) {
+            unlink(temp.c_str());
+            return false;
+        }
+
+        if (sync != sync_mode::none) {
+            const auto parent = target.parent_path();
+            const int dir = ::open(parent.empty() ? "." : parent.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            if (dir != -1) {
+                ok = fsync(dir) == 0;
+                close(dir);
+            }
+        }
+        return ok;
+        #endif
+    }
+
+    struct writer_options {
+        /**
+         * Rounded down to a multiple of 4096
+         */
+        size_t buffer_size = 1024 * 1024;
+        bool append = false;
+
+        /**
+         * Bypass the page cache with O_DIRECT (Linux), everything is then staged through the aligned buffer
+         * Quietly falls back to normal writes where the OS or file system refuses it, at open or on a write failing with EINVAL, ignored on other platforms
+         */
+        bool direct = false;
+    };
+
+    /**
+     * Buffered file writer that hands the OS large writes
+     * Batches of string_views are written with one writev instead of being concatenated first
+     * Any failed write sets failed() and makes every later call return false
+     */
+    class writer {
+    public:
+        /**
+         * O_DIRECT needs buffers, sizes and offsets aligned to the device block, 4096 covers every common one
+         */
+        static constexpr size_t direct_alignment = 4096;
+    private:
+        struct aligned_delete {
+            void operator()(char* p) const noexcept {
+                ::operator delete[](p, std::align_val_t{direct_alignment});
+            }
+        };
+
+        #ifdef WIN32
+        HANDLE file = INVALID_HANDLE_VALUE;
+        #else
+        int fd = -1;
+        #endif
+        std::unique_ptr<char[], aligned_delete> buffer;
+        size_t capacity = 0;
+        size_t used = 0;
+        uint64_t total = 0;
+        bool direct = false;
+        bool failed_ = false;
+
+        [[nodiscard]] bool is_open() const noexcept {
+            #ifdef WIN32
+            return file != INVALID_HANDLE_VALUE;
+            #else
+            return fd != -1;
+            #endif
+        }
+
+        [[nodiscard]] bool write_raw(std::string_view bytes) noexcept {
+            #ifdef WIN32
+            while (!bytes.empty()) {
+                DWORD written = 0;
+                if (!WriteFile(file, bytes.data(), static_cast<DWORD>(std::min<size_t>(bytes.size(), 1u << 30)), &written, nullptr) || written == 0) return false;
+                bytes.remove_prefix(written);
+            }
+            return true;
+            #else
+            return internal::write_all(fd, bytes);
+            #endif
+        }
+
+        /**
+         * The buffer followed by parts in as few syscalls as possible, empties the buffer
+         */
+        [[nodiscard]] bool write_gather(const std::span<const std::string_view> parts) noexcept {
+            #ifdef WIN32
+            bool ok = write_raw({buffer.get(), used});
+            for (const auto part : parts) ok = ok && write_raw(part);
+            used = 0;
+            return ok;
+            #else
+            constexpr size_t max_iov = 64;
+            iovec iov[max_iov];
+            size_t count = 0;
+            if (used > 0) iov[count++] = {buffer.get(), used};
+            used = 0;
+
+            size_t next = 0;
+            while (count > 0 || next < parts.size()) {
+                while (count < max_iov && next < parts.size()) {
+                    if (!parts[next].empty()) iov[count++] = {const_cast<char*>(parts[next].data()), parts[next].size()};
+                    ++next;
+                }
+                if (count == 0) break;
+
+                auto n = writev(fd, iov, static_cast<int>(count));
+                if (n < 0 && errno == EINTR) continue;
+                if (n <= 0) return false;
+
+                // drop what went out, a short write leaves the rest of the first unfinished entry in place
+                size_t done = 0;
+                while (done < count && static_cast<size_t>(n) >= iov[done].iov_len) {
+                    n -= static_cast<ssize_t>(iov[done].iov_len);
+                    ++done;
+                }
+                if (done < count) {
+                    iov[done].iov_base = static_cast<char*>(iov[done].iov_base) + n;
+                    iov[done].iov_len -= static_cast<size_t>(n);
+                }
+                std::move(iov + done, iov + count, iov);
+                count -= done;
+            }
+            return true;
+            #endif
+        }
+
+        #if !defined(WIN32) && defined(O_DIRECT)
+        bool leave_direct() noexcept {
+            const auto flags = fcntl(fd, F_GETFL);
+            if (flags == -1 || fcntl(fd, F_SETFL, flags & ~O_DIRECT) == -1) return false;
+            direct = false;
+            return true;
+        }
+        #endif
+
+        /**
+         * In direct mode only whole blocks leave the buffer, the remainder moves to the front
+         */
+        [[nodiscard]] bool drain(const bool everything) noexcept {
+            if (!direct) return write_gather({});
+
+            const auto aligned = everything ? used : used - used % direct_alignment;
+            if (aligned == 0) return true;
+            #if !defined(WIN32) && defined(O_DIRECT)
+            for (size_t done = 0; done < aligned;) {
+                const auto n = ::write(fd, buffer.get() + done, aligned - done);
+                if (n < 0 && errno == EINTR) continue;
+                if (n < 0 && errno == EINVAL) {
+                    // some file systems accept O_DIRECT at open and only refuse the writes, the rest goes through the page cache
+                    std::memmove(buffer.get(), buffer.get() + done, used - done);
+                    used -= done;
+                    return leave_direct() && write_gather({});
+                }
+                if (n <= 0) return false;
+                done += static_cast<size_t>(n);
+            }
+            #else
+            if (!write_raw({buffer.get(), aligned})) return false;
+            #endif
+            std::memmove(buffer.get(), buffer.get() + aligned, used - aligned);
+            used -= aligned;
+            return true;
+        }
+
+        bool fail() noexcept {
+            failed_ = true;
+            return false;
+        }
+
+        writer() noexcept = default;
+    public:
+        writer(const writer&) = delete;
+        writer& operator=(const writer&) = delete;
+
+        writer(writer&& other) noexcept
+            #ifdef WIN32
+            : file(std::exchange(other.file, INVALID_HANDLE_VALUE)),
+            #else
+            : fd(std::exchange(other.fd, -1)),
+            #endif
+              buffer(std::move(other.buffer)), capacity(other.capacity), used(std::exchange(other.used, 0)),
+              total(other.total), direct(other.direct), failed_(other.failed_) {}
+
+        writer& operator=(writer&& other) noexcept {
+            if (this != &other) {
+                close();
+                #ifdef WIN32
+                file = std::exchange(other.file, INVALID_HANDLE_VALUE);
+                #else
+                fd = std::exchange(other.fd, -1);
+                #endif
+                buffer = std::move(other.buffer);
+                capacity = other.capacity;
+                used = std::exchange(other.used, 0);
+                total = other.total;
+                direct = other.direct;
+                failed_ = other.failed_;
+            }
+            return *this;
+        }
+
+        /**
+         * Flushes and closes, call close yourself to find out whether that worked
+         */
+        ~writer() {
+            close();
+        }
+
+        /**
+         * Creates or truncates path (or appends with opts.append), returns std::nullopt if it cannot be opened
+         */
+        [[nodiscard]] static std::optional<writer> open(const std::filesystem::path& path, const writer_options& opts = {}) {
+            writer result;
+            result.capacity = std::max(opts.buffer_size, direct_alignment);
+            result.capacity -= result.capacity % direct_alignment;
+
+            #ifdef WIN32
+            result.file = CreateFileW(path.c_str(), opts.append ? FILE_APPEND_DATA : GENERIC_WRITE, 0, nullptr, opts.append ? OPEN_ALWAYS : CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+            if (result.file == INVALID_HANDLE_VALUE) return std::nullopt;
+            #else
+            const int flags = O_WRONLY | O_CREAT | O_CLOEXEC | (opts.append ? O_APPEND : O_TRUNC);
+            #ifdef O_DIRECT
+            // appending to a file whose size is not block aligned would misalign every write
+            if (opts.direct && !opts.append) {
+                result.fd = ::open(path.c_str(), flags | O_DIRECT, 0666);
+                result.direct = result.fd != -1;
+            }
+            #endif
+            if (result.fd == -1) result.fd = ::open(path.c_str(), flags, 0666);
+            if (result.fd == -1) return std::nullopt;
+            #endif
+
+            result.buffer.reset(static_cast<char*>(::operator new[](result.capacity, std::align_val_t{direct_alignment})));
+            return result;
+        }
+
+        bool write(const std::string_view bytes) noexcept {
+            if (failed_ || !is_open()) return false;
+            total += bytes.size();
+
+            if (bytes.size() <= capacity - used) {
+                std::memcpy(buffer.get() + used, bytes.data(), bytes.size());
+                used += bytes.size();
+                return true;
+            }
+
+            if (!direct) return write_gather({&bytes, 1}) || fail();
+
+            for (auto rest = bytes; !rest.empty();) {
+                const auto take = std::min(rest.size(), capacity - used);
+                std::memcpy(buffer.get() + used, rest.data(), take);
+                used += take;
+                rest.remove_prefix(take);
+                if (used == capacity && !drain(false)) return fail();
+            }
+            return true;
+        }
+
+        /**
+         * Writes the parts back to back, straight from their own memory with writev when they do not fit in the buffer
+         */
+        bool write(const std::span<const std::string_view> parts) noexcept {
+            if (failed_ || !is_open()) return false;
+
+            size_t size = 0;
+            for (const auto part : parts) size += part.size();
+
+            if (size <= capacity - used || direct) {
+                for (const auto part : parts) {
+                    if (!write(part)) return false;
+                }
+                return true;
+            }
+
+            total += size;
+            return write_gather(parts) || fail();
+        }
+
+        bool write(const std::initializer_list<std::string_view> parts) noexcept {
+            return write(std::span<const std::string_view>{parts.begin(), parts.size()});
+        }
+
+        /**
+         * Hands everything buffered to the OS, in direct mode a partial block is kept back until close
+         */
+        bool flush() noexcept {
+            if (failed_ || !is_open()) return false;
+            return drain(false) || fail();
+        }
+
+        /**
+         * flush, then push the data to the device as sync asks
+         */
+        bool sync(const sync_mode mode = sync_mode::data) noexcept {
+            if (!flush()) return false;
+            #ifdef WIN32
+            return mode == sync_mode::none || FlushFileBuffers(file) || fail();
+            #else
+            return internal::sync_fd(fd, mode) || fail();
+            #endif
+        }
+
+        /**
+         * Writes what is left and closes, returns false if anything since open failed
+         */
+        bool close() noexcept {
+            if (!is_open()) return false;
+
+            #if !defined(WIN32) && defined(O_DIRECT)
+            // the last partial block cannot go out with O_DIRECT, so it is written through the page cache
+            if (direct && !failed_ && drain(false) && used > 0) leave_direct();
+            #endif
+            if (!failed_ && !drain(true)) fail();
+
+            #ifdef WIN32
+            if (!CloseHandle(file)) fail();
+            file = INVALID_HANDLE_VALUE;
+            #else
+            if (::close(fd) != 0) fail();
+            fd = -1;
+            #endif
+            return !failed_;
+        }
+
+        /**
+         * Bytes accepted so far, buffered or not
+         */
+        [[nodiscard]] uint64_t bytes_written() const noexcept {
+            return total;
+        }
+
+        [[nodiscard]] bool failed() const noexcept {
+            return failed_;
+        }
+
+        /**
+         * Whether writes currently bypass the page cache, false when direct was not asked for or the OS or file system refused it
+         */
+        [[nodiscard]] bool is_direct() const noexcept {
+            return direct;
+        }
+    };
+}
@@ -0,0 +1,333 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <format>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include "time.hpp"
+
+/**
+ * Asynchronous logging, producers only format into a lock free ring buffer and a background thread does the I/O
+ */
+namespace usylibpp::log {
+    enum class level : uint8_t {
+        trace,
+        debug,
+        info,
+        warn,
+        error
+    };
+
+    [[nodiscard]] inline constexpr std::string_view level_name(const level lvl) noexcept {
+        constexpr std::string_view names[] = {"TRACE", "DEBUG", "INFO", "WARN", "ERROR"};
+        return names[static_cast<size_t>(lvl)];
+    }
+
+    /**
+     * What a producer does when the ring buffer is full
+     * drop discards the message and counts it, block waits for the writer thread to make room
+     */
+    enum class overflow_policy {
+        drop,
+        block
+    };
+
+    struct options {
+        /**
+         * Rounded up to a power of two
+         */
+        size_t capacity = 8192;
+        overflow_policy overflow = overflow_policy::drop;
+        level min_level = level::info;
+        std::chrono::milliseconds flush_interval{10};
+    };
+
+    /**
+     * Longer messages are truncated
+     */
+    inline constexpr size_t max_message_length = 232;
+
+    class logger {
+    private:
+        struct record {
+            std::atomic<size_t> sequence{0};
+            std::time_t time{};
+            level lvl{};
+            uint16_t length = 0;
+            char text[max_message_length];
+        };
+
+        std::unique_ptr<record[]> ring;
+        size_t mask;
+        overflow_policy overflow;
+        std::chrono::milliseconds flush_interval;
+        std::FILE* out;
+        bool owns_out;
+
+        std::atomic<level> min_level;
+        std::atomic<size_t> enqueue_pos{0};
+        std::atomic<size_t> written{0};
+        std::atomic<size_t> dropped_count{0};
+        size_t dequeue_pos = 0;
+
+        std::atomic<bool> idle{false};
+        std::atomic<bool> stopping{false};
+        std::mutex wake_mutex;
+        std::condition_variable wake;
+        std::thread writer;
+
+        [[nodiscard]] static size_t round_capacity(const size_t capacity) noexcept {
+            size_t rounded = 2;
+            while (rounded < capacity) rounded *= 2;
+            return rounded;
+        }
+
+        void notify_writer() {
+            if (idle.load(std::memory_order_acquire)) {
+                std::lock_guard lock{wake_mutex};
+                wake.notify_one();
+            }
+        }
+
+        /**
+         * Claims a slot with the bounded MPMC scheme from Dmitry Vyukov, returns nullptr when the ring is full
+         */
+        [[nodiscard]] record* try_claim(size_t& pos) noexcept {
+            pos = enqueue_pos.load(std::memory_order_relaxed);
+            while (true) {
+                auto& slot = ring[pos & mask];
+                const auto sequence = slot.sequence.load(std::memory_order_acquire);
+                const auto diff = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(pos);
+                if (diff == 0) {
+                    if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) return &slot;
+                } else if (diff < 0) {
+                    return nullptr;
+                } else {
+                    pos = enqueue_pos.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        void run() {
+            std::string batch;
+            char stamp[time::datetime_length];
+
+            while (true) {
+                batch.clear();
+                size_t drained = 0;
+
+                while (true) {
+                    auto& slot = ring[dequeue_pos & mask];
+                    if (slot.sequence.load(std::memory_order_acquire) != dequeue_pos + 1) break;
+
+                    time::datetime_into(stamp, slot.time);
+                    batch.append(stamp, time::datetime_length);
+                    batch += " [";
+                    batch += level_name(slot.lvl);
+                    batch += "] ";
+                    batch.append(slot.text, slot.length);
+                    batch += '\n';
+
+                    slot.sequence.store(dequeue_pos + mask + 1, std::memory_order_release);
+                    ++dequeue_pos;
+                    ++drained;
+                }
+
+                if (drained > 0) {
+                    std::fwrite(batch.data(), 1, batch.size(), out);
+                    std::fflush(out);
+                    written.fetch_add(drained, std::memory_order_release);
+                    written.notify_all();
+                    continue;
+                }
+
+                if (stopping.load(std::memory_order_acquire)) return;
+
+                std::unique_lock lock{wake_mutex};
+                idle.store(true, std::memory_order_release);
+                wake.wait_for(lock, flush_interval);
+                idle.store(false, std::memory_order_release);
+            }
+        }
+    public:
+        explicit logger(std::FILE* out = stdout, const options& opts = {}, bool owns_out = false)
+            : ring(std::make_unique<record[]>(round_capacity(opts.capacity))),
+              mask(round_capacity(opts.capacity) - 1),
+              overflow(opts.overflow),
+              flush_interval(opts.flush_interval),
+              out(out),
+              owns_out(owns_out),
+              min_level(opts.min_level) {
+            for (size_t i = 0; i <= mask; ++i) ring[i].sequence.store(i, std::memory_order_relaxed);
+            writer = std::thread{[this] { run(); }};
+        }
+
+        /**
+         * Appends to the file at path, returns nullptr if it cannot be opened
+         */
+        [[nodiscard]] static std::unique_ptr<logger> open(const std::filesystem::path& path, const options& opts = {}) {
+            #ifdef WIN32
+            std::FILE* file = _wfopen(path.c_str(), L"ab");
+            #else
+            std::FILE* file = std::fopen(path.c_str(), "ab");
+            #endif
+            if (!file) return nullptr;
+            return std::make_unique<logger>(file, opts, true);
+        }
+
+        logger(const logger&) = delete;
+        logger& operator=(const logger&) = delete;
+
+        /**
+         * Writes out everything still queued before returning
+         */
+        ~logger() {
+            stopping.store(true, std::memory_order_release);
+            {
+                std::lock_guard lock{wake_mutex};
+                wake.notify_one();
+            }
+            writer.join();
+            if (owns_out) std::fclose(out);
+        }
+
+        /**
+         * Formats on the calling thread straight into a ring slot, the timestamp and I/O happen on the writer thread
+         * Returns false if the message was filtered out by level or dropped because the ring was full
+         * An exception from formatting is rethrown after "<format error>" is logged in the message's place
+         */
+        template <typename... Ts>
+        bool write(const level lvl, std::format_string<Ts...> fmt, Ts&&... args) {
+            if (lvl < min_level.load(std::memory_order_relaxed)) return false;
+
+            size_t pos = 0;
+            record* slot = try_claim(pos);
+            while (!slot) {
+                if (overflow == overflow_policy::drop) {
+                    dropped_count.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+                notify_writer();
+                std::this_thread::yield();
+                slot = try_claim(pos);
+            }
+
+            slot->time = std::time(nullptr);
+            slot->lvl = lvl;
+            try {
+                const auto result = std::format_to_n(slot->text, max_message_length, fmt, std::forward<Ts>(args)...);
+                slot->length = static_cast<uint16_t>(result.out - slot->text);
+            } catch (...) {
+                // the claimed slot has to be published either way, the writer thread would otherwise stop at it for good
+                constexpr std::string_view failed = "<format error>";
+                std::memcpy(slot->text, failed.data(), failed.size());
+                slot->length = static_cast<uint16_t>(failed.size());
+                slot->sequence.store(pos + 1, std::memory_order_release);
+                notify_writer();
+                throw;
+            }
+            slot->sequence.store(pos + 1, std::memory_order_release);
+
+            notify_writer();
+            return true;
+        }
+
+        template <typename... Ts>
+        bool trace(std::format_string<Ts...> fmt, Ts&&... args) {
+            return write(level::trace, fmt, std::forward<Ts>(args)...);
+        }
+
+        template <typename... Ts>
+        bool debug(std::format_string<Ts...> fmt, Ts&&... args) {
+            return write(level::debug, fmt, std::forward<Ts>(args)...);
+        }
+
+        template <typename... Ts>
+        bool info(std::format_string<Ts...> fmt, Ts&&... args) {
+            return write(level::info, fmt, std::forward<Ts>(args)...);
+        }
+
+        template <typename... Ts>
+        bool warn(std::format_string<Ts...> fmt, Ts&&... args) {
+            return write(level::warn, fmt, std::forward<Ts>(args)...);
+        }
+
+        template <typename... Ts>
+        bool error(std::format_string<Ts...> fmt, Ts&&... args) {
+            return write(level::error, fmt, std::forward<Ts>(args)...);
+        }
+
+        void set_level(const level lvl) noexcept {
+            min_level.store(lvl, std::memory_order_relaxed);
+        }
+
+        [[nodiscard]] level get_level() const noexcept {
+            return min_level.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * Number of messages discarded by overflow_policy::drop so far
+         */
+        [[nodiscard]] size_t dropped() const noexcept {
+            return dropped_count.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * Blocks until everything queued before the call has been written
+         */
+        void flush() {
+            // slots claimed but not yet filled in count as queued, the writer picks them up once they are published
+            const auto target = enqueue_pos.load(std::memory_order_acquire);
+            {
+                std::lock_guard lock{wake_mutex};
+                wake.notify_one();
+            }
+            for (auto done = written.load(std::memory_order_acquire); done < target; done = written.load(std::memory_order_acquire)) {
+                written.wait(done, std::memory_order_acquire);
+            }
+        }
+    };
+
+    /**
+     * Logs to stdout, created on first use
+     */
+    [[nodiscard]] inline logger& default_logger() {
+        static logger instance{};
+        return instance;
+    }
+
+    template <typename... Ts>
+    inline bool trace(std::format_string<Ts...> fmt, Ts&&... args) {
+        return default_logger().write(level::trace, fmt, std::forward<Ts>(args)...);
+    }
+
+    template <typename... Ts>
+    inline bool debug(std::format_string<Ts...> fmt, Ts&&... args) {
+        return default_logger().write(level::debug, fmt, std::forward<Ts>(args)...);
+    }
+
+    template <typename... Ts>
+    inline bool info(std::format_string<Ts...> fmt, Ts&&... args) {
+        return default_logger().write(level::info, fmt, std::forward<Ts>(args)...);
+    }
+
+    template <typename... Ts>
+    inline bool warn(std::format_string<Ts...> fmt, Ts&&... args) {
+        return default_logger().write(level::warn, fmt, std::forward<Ts>(args)...);
+    }
+
+    template <typename... Ts>
+    inline bool error(std::format_string<Ts...> fmt, Ts&&... args) {
+        return default_logger().write(level::error, fmt, std::forward<Ts>(args)...);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,499 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#ifdef WIN32
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+/**
+ * Work stealing thread pool and the parallel loops built on it
+ * Every worker owns a deque, it pushes and pops its own work at the back while idle workers steal from the front of the others
+ */
+namespace usylibpp::parallel {
+    struct pool_options {
+        /**
+         * 0 for std::thread::hardware_concurrency
+         */
+        size_t threads = 0;
+        /**
+         * Pins worker i to CPU i modulo the CPU count, on Linux and Windows
+         */
+        bool pin_threads = false;
+    };
+
+    namespace internal {
+        /**
+         * Type erased move only callable, std::function would reject packaged_task and lambdas holding one
+         */
+        class task {
+        private:
+            struct base {
+                virtual ~base() = default;
+                virtual void run() = 0;
+            };
+
+            template <typename F>
+            struct holder final : base {
+                F f;
+
+                template <typename G>
+                explicit holder(G&& g) : f(std::forward<G>(g)) {}
+
+                void run() override {
+                    f();
+                }
+            };
+
+            std::unique_ptr<base> ptr;
+        public:
+            task() = default;
+
+            template <typename F>
+            explicit task(F&& f) : ptr(std::make_unique<holder<std::decay_t<F>>>(std::forward<F>(f))) {}
+
+            void operator()() {
+                ptr->run();
+            }
+        };
+
+        struct worker_identity {
+            const void* pool = nullptr;
+            size_t index = 0;
+        };
+
+        /**
+         * Which pool the current thread works for, so work it posts lands in its own deque
+         */
+        inline thread_local worker_identity current_worker;
+
+        inline void pin_to_cpu(const size_t index) noexcept {
+            const auto cpus = std::max(1u, std::thread::hardware_concurrency());
+            #ifdef WIN32
+            SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR{1} << (index % std::min<size_t>(cpus, sizeof(DWORD_PTR) * 8)));
+            #elif defined(__linux__)
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(index % std::min<size_t>(cpus, CPU_SETSIZE), &set);
+            pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+            #else
+            (void) index;
+            (void) cpus;
+            #endif
+        }
+    }
+
+    class thread_pool {
+    private:
+        struct alignas(64) queue {
+            std::mutex mutex;
+            std::deque<internal::task> tasks;
+        };
+
+        size_t worker_count;
+        bool pin_threads;
+        /**
+         * One deque per worker, the last one takes work posted from outside the pool
+         */
+        std::unique_ptr<queue[]> queues;
+
+        /**
+         * Raised before a task is pushed and lowered once one is taken, so it never undercounts
+         */
+        std::atomic<size_t> queued{0};
+        std::atomic<size_t> sleeping{0};
+        std::atomic<bool> stopping{false};
+        std::mutex sleep_mutex;
+        std::condition_variable wake;
+        std::vector<std::jthread> threads;
+
+        [[nodiscard]] static bool pop(queue& q, const bool back, internal::task& out) {
+            std::lock_guard lock{q.mutex};
+            if (q.tasks.empty()) return false;
+            if (back) {
+                out = std::move(q.tasks.back());
+                q.tasks.pop_back();
+            } else {
+                out = std::move(q.tasks.front());
+                q.tasks.pop_front();
+            }
+            return true;
+        }
+
+        /**
+         * Own deque newest first, then the shared queue, then the oldest work of the other workers
+         */
+        [[nodiscard]] bool take(internal::task& out) {
+            if (queued.load(std::memory_order_acquire) == 0) return false;
+
+            const bool is_worker = internal::current_worker.pool == this;
+            const auto self = is_worker ? internal::current_worker.index : worker_count;
+            bool found = (is_worker && pop(queues[self], true, out)) || pop(queues[worker_count], false, out);
+            for (size_t i = 1; !found && i <= worker_count; ++i) {
+                const auto victim = (self + i) % (worker_count + 1);
+                if (victim != worker_count) found = pop(queues[victim], false, out);
+            }
+
+            if (found) queued.fetch_sub(1, std::memory_order_relaxed);
+            return found;
+        }
+
+        void run(const size_t index) {
+            internal::current_worker = {this, index};
+            if (pin_threads) internal::pin_to_cpu(index);
+
+            while (true) {
+                if (try_run_one()) continue;
+
+                std::unique_lock lock{sleep_mutex};
+                sleeping.fetch_add(1);
+                wake.wait(lock, [&] { return queued.load() > 0 || stopping.load(); });
+                sleeping.fetch_sub(1);
+                if (stopping.load() && queued.load() == 0) return;
+            }
+        }
+    public:
+        explicit thread_pool(const pool_options& opts = {})
+            : worker_count(opts.threads == 0 ? std::max(1u, std::thread::hardware_concurrency()) : opts.threads),
+              pin_threads(opts.pin_threads),
+              queues(std::make_unique<queue[]>(worker_count + 1)) {
+            threads.reserve(worker_count);
+            for (size_t i = 0; i < worker_count; ++i) threads.emplace_back([this, i] { run(i); });
+        }
+
+        thread_pool(const thread_pool&) = delete;
+        thread_pool& operator=(const thread_pool&) = delete;
+
+        /**
+         * Finishes everything already queued
+         */
+        ~thread_pool() {
+            stopping.store(true);
+            {
+                std::lock_guard lock{sleep_mutex};
+            }
+            wake.notify_all();
+        }
+
+        [[nodiscard]] size_t size() const noexcept {
+            return worker_count;
+        }
+
+        /**
+         * Queues f without a way to wait for it, f must not throw
+         */
+        template <typename F>
+        void post(F&& f) {
+            const bool is_worker = internal::current_worker.pool == this;
+            auto& q = queues[is_worker ? internal::current_worker.index : worker_count];
+
+            queued.fetch_add(1);
+            {
+                std::lock_guard lock{q.mutex};
+                q.tasks.emplace_back(std::forward<F>(f));
+            }
+
+            if (sleeping.load() > 0) {
+                {
+                    std::lock_guard lock{sleep_mutex};
+                }
+                wake.notify_one();
+            }
+        }
+
+        template <typename F>
+        [[nodiscard]] std::future<std::invoke_result_t<std::decay_t<F>>> submit(F&& f) {
+            std::packaged_task<std::invoke_result_t<std::decay_t<F>>()> task{std::forward<F>(f)};
+            auto future = task.get_future();
+            post(std::move(task));
+            return future;
+        }
+
+        /**
+         * Runs one queued task on the calling thread, how waiting threads help instead of blocking
+         * Returns false if there was nothing to run
+         */
+        bool try_run_one() {
+            internal::task t;
+            if (!take(t)) return false;
+            t();
+            return true;
+        }
+
+        struct schedule_awaiter {
+            thread_pool* pool;
+
+            [[nodiscard]] bool await_ready() const noexcept {
+                return false;
+            }
+
+            void await_suspend(const std::coroutine_handle<> handle) {
+                pool->post([handle] { handle.resume(); });
+            }
+
+            void await_resume() const noexcept {}
+        };
+
+        /**
+         * co_await pool.schedule() resumes the coroutine on one of the workers
+         */
+        [[nodiscard]] schedule_awaiter schedule() noexcept {
+            return {this};
+        }
+    };
+
+    /**
+     * std::thread::hardware_concurrency workers, created on first use
+     */
+    [[nodiscard]] inline thread_pool& default_pool() {
+        static thread_pool pool{};
+        return pool;
+    }
+
+    /**
+     * co_await parallel::schedule() moves the coroutine onto the default pool
+     */
+    [[nodiscard]] inline thread_pool::schedule_awaiter schedule() {
+        return default_pool().schedule();
+    }
+
+    /**
+     * Tasks that are waited for together, tasks may add more tasks to the group they are in
+     * While waiting the calling thread runs queued work, so waiting from inside a worker cannot starve the pool
+     * The first exception thrown by a task is rethrown by wait
+     */
+    class task_group {
+    private:
+        thread_pool& pool;
+        std::mutex mutex;
+        std::condition_variable done;
+        size_t pending = 0;
+        std::exception_ptr error;
+
+        void finish(std::exception_ptr failure) {
+            // the count only drops under the lock so wait cannot return, and the group go away, while this still touches it
+            std::lock_guard lock{mutex};
+            if (failure && !error) error = std::move(failure);
+            if (--pending == 0) done.notify_all();
+        }
+
+        void wait_quietly() {
+            while (true) {
+                {
+                    std::lock_guard lock{mutex};
+                    if (pending == 0) return;
+                }
+                if (pool.try_run_one()) continue;
+
+                std::unique_lock lock{mutex};
+                done.wait_for(lock, std::chrono::milliseconds(1), [&] { return pending == 0; });
+            }
+        }
+    public:
+        explicit task_group(thread_pool& pool = default_pool()) : pool(pool) {}
+
+        task_group(const task_group&) = delete;
+        task_group& operator=(const task_group&) = delete;
+
+        ~task_group() {
+            wait_quietly();
+        }
+
+        template <typename F>
+        void run(F&& f) {
+            {
+                std::lock_guard lock{mutex};
+                ++pending;
+            }
+            pool.post([this, f = std::forward<F>(f)]() mutable {
+                std::exception_ptr failure;
+                try {
+                    f();
+                } catch (...) {
+                    failure = std::current_exception();
+                }
+                finish(std::move(failure));
+            });
+        }
+
+        void wait() {
+            wait_quietly();
+            std::exception_ptr failure;
+            {
+                std::lock_guard lock{mutex};
+                failure = std::exchange(error, nullptr);
+            }
+            if (failure) std::rethrow_exception(failure);
+        }
+    };
+
+    namespace internal {
+        /**
+         * A few chunks per thread so stealing can even out uneven chunks
+         */
+        inline constexpr size_t chunks_per_thread = 4;
+
+        /**
+         * Calls f(chunk) for chunk in [0, count), chunk 0 on the calling thread
+         */
+        inline void run_chunks(thread_pool& pool, const size_t count, const auto& f) {
+            if (count == 1) {
+                f(size_t{0});
+                return;
+            }
+
+            task_group group{pool};
+            for (size_t i = 1; i < count; ++i) group.run([&f, i] { f(i); });
+            f(size_t{0});
+            group.wait();
+        }
+
+        /**
+         * Result of one chunk of a reduction, on its own cache line so chunks finishing together do not invalidate each other
+         * Chunks fold into a local and store it once, which also keeps std::vector<bool> style proxies out of the hot loop
+         */
+        template <typename T>
+        struct alignas(64) partial {
+            std::optional<T> value;
+        };
+
+        /**
+         * Merges the chunk results in index order
+         */
+        template <typename T>
+        [[nodiscard]] inline T merge_partials(partial<T>* partials, const size_t count, const auto& reduce) {
+            T total = std::move(*partials[0].value);
+            for (size_t i = 1; i < count; ++i) reduce(total, std::move(*partials[i].value));
+            return total;
+        }
+
+        [[nodiscard]] inline size_t index_chunks(const thread_pool& pool, const size_t size, const size_t grain) noexcept {
+            const auto by_grain = (size + std::max<size_t>(1, grain) - 1) / std::max<size_t>(1, grain);
+            return std::max<size_t>(1, std::min(by_grain, (pool.size() + 1) * chunks_per_thread));
+        }
+    }
+
+    /**
+     * Calls f(i) for every i in [begin, end) across the pool, chunks are never smaller than grain indices
+     * f is called concurrently so it has to be thread safe
+     */
+    inline void parallel_for(const size_t begin, const size_t end, const auto& f, const size_t grain = 1, thread_pool& pool = default_pool()) {
+        if (begin >= end) return;
+        const auto size = end - begin;
+        const auto chunks = internal::index_chunks(pool, size, grain);
+        internal::run_chunks(pool, chunks, [&](const size_t chunk) {
+            const auto first = begin + size * chunk / chunks;
+            const auto last = begin + size * (chunk + 1) / chunks;
+            for (auto i = first; i < last; ++i) f(i);
+        });
+    }
+
+    /**
+     * Map-reduce over [begin, end), every chunk folds its indices into a local copy of init with map(T& acc, size_t i)
+     * The accumulators are then merged in index order with reduce(T& total, T&& acc), so init should be the identity value
+     */
+    template <typename T>
+    [[nodiscard]] inline T parallel_reduce(const size_t begin, const size_t end, const T& init, const auto& map, const auto& reduce, const size_t grain = 1, thread_pool& pool = default_pool()) {
+        if (begin >= end) return init;
+        const auto size = end - begin;
+        const auto chunks = internal::index_chunks(pool, size, grain);
+
+        const auto partials = std::make_unique<internal::partial<T>[]>(chunks);
+        internal::run_chunks(pool, chunks, [&](const size_t chunk) {
+            const auto first = begin + size * chunk / chunks;
+            const auto last = begin + size * (chunk + 1) / chunks;
+            T acc = init;
+            for (auto i = first; i < last; ++i) map(acc, i);
+            partials[chunk].value.emplace(std::move(acc));
+        });
+
+        return internal::merge_partials(partials.get(), chunks, reduce);
+    }
+
+    /**
+     * Below this many bytes per chunk handing text to another thread costs more than it saves
+     */
+    inline constexpr size_t min_chunk_size = 64 * 1024;
+
+    /**
+     * How many chunks of at least min_chunk_size to cut size bytes into, at most max_chunks (0 for std::thread::hardware_concurrency)
+     */
+    [[nodiscard]] inline size_t chunk_count(const size_t size, size_t max_chunks) noexcept {
+        if (max_chunks == 0) max_chunks = std::max(1u, std::thread::hardware_concurrency());
+        return std::max<size_t>(1, std::min(max_chunks, size / min_chunk_size));
+    }
+
+    /**
+     * Splits input into at most count pieces that each end right after a delimiter (except the last)
+     * so no record is cut in half, processing every piece visits the same records as processing the whole input
+     */
+    [[nodiscard]] inline std::vector<std::string_view> split_chunks(const std::string_view input, const size_t count, const char delimiter = '\n') {
+        std::vector<std::string_view> chunks;
+        chunks.reserve(count);
+
+        size_t start = 0;
+        for (size_t i = 1; i <= count && start < input.size(); ++i) {
+            size_t end = input.size();
+            if (i < count) {
+                const auto target = std::max(start, input.size() / count * i);
+                const auto found = input.find(delimiter, target);
+                if (found != std::string_view::npos) end = found + 1;
+            }
+            chunks.push_back(input.substr(start, end - start));
+            start = end;
+        }
+        return chunks;
+    }
+
+    /**
+     * Calls f(std::string_view chunk) on delimiter aligned chunks of input across the pool, at most max_chunks of them (0 for std::thread::hardware_concurrency)
+     * Small inputs are passed whole to f on the calling thread
+     */
+    inline void for_each_chunk(const std::string_view input, const char delimiter, const auto& f, const size_t max_chunks = 0, thread_pool& pool = default_pool()) {
+        const auto chunks = split_chunks(input, chunk_count(input.size(), max_chunks), delimiter);
+        if (chunks.size() <= 1) {
+            f(input);
+            return;
+        }
+        internal::run_chunks(pool, chunks.size(), [&](const size_t i) { f(chunks[i]); });
+    }
+
+    /**
+     * Map-reduce over delimiter aligned chunks of input, map(T& acc, std::string_view chunk) and reduce(T& total, T&& acc) as in parallel_reduce
+     * Empty input gives init
+     */
+    template <typename T>
+    [[nodiscard]] inline T reduce_chunks(const std::string_view input, const char delimiter, const T& init, const auto& map, const auto& reduce, const size_t max_chunks = 0, thread_pool& pool = default_pool()) {
+        const auto chunks = split_chunks(input, chunk_count(input.size(), max_chunks), delimiter);
+
+        if (chunks.empty()) return init;
+
+        const auto partials = std::make_unique<internal::partial<T>[]>(chunks.size());
+        internal::run_chunks(pool, chunks.size(), [&](const size_t i) {
+            T acc = init;
+            map(acc, chunks[i]);
+            partials[i].value.emplace(std::move(acc));
+        });
+
+        return internal::merge_partials(partials.get(), chunks.size(), reduce);
+    }
+}
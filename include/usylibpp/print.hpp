@@ -1,37 +1,125 @@
 #pragma once
 
+#include <cstdio>
 #include <iostream>
 #include <format>
+#include <iterator>
+#include <string>
+#include <utility>
+#include "strings.hpp"
+#include "unicode.hpp"
 
 namespace usylibpp::print {
+    namespace internal {
+        /**
+         * Reused per thread, so formatting stops allocating once the buffer has grown to the longest line
+         */
+        template <typename Char>
+        [[nodiscard]] inline std::basic_string<Char>& buffer() {
+            static thread_local std::basic_string<Char> buf;
+            buf.clear();
+            return buf;
+        }
+
+        template <typename Char, typename Fmt, typename... Ts>
+        [[nodiscard]] inline std::basic_string<Char>& format(const bool newline, Fmt fmt, Ts&&... args) {
+            auto& buf = buffer<Char>();
+            std::format_to(std::back_inserter(buf), fmt, std::forward<Ts>(args)...);
+            if (newline) buf.push_back(Char('\n'));
+            return buf;
+        }
+
+        /**
+         * Transcodes into a second per thread buffer so wide output goes to C streams as UTF-8 without touching the locale
+         */
+        inline void write_wide(std::FILE* stream, const std::wstring_view text) {
+            static thread_local std::string utf8;
+            const auto length = unicode::utf8_length(text);
+            if (!length) return;
+            utf8.resize(*length);
+            (void) unicode::to_utf8_into(text, utf8);
+            std::fwrite(utf8.data(), 1, utf8.size(), stream);
+        }
+    }
+
     /**
-     * Will fail silently on mismatched paranthesis and args
-     * Prints to cout or wcout depending on the args passed in
+     * The format string is checked against the args at compile time
+     * Formats into a per thread buffer and hands it to cout or wcout in a single write
      */
-    template<typename Fmt = const char*, typename... Ts>
-    inline auto& print(Fmt&& fmt = "", Ts&&... args) {
-        // using Char = typename std::basic_string_view<std::remove_cvref_t<decltype(fmt[0])>>::value_type;
-        using Char = std::remove_cvref_t<decltype(fmt[0])>;
-
-        if constexpr (std::is_same_v<Char, char>) {
-            std::cout << std::vformat(std::forward<Fmt>(fmt), std::make_format_args(args...));
-            return std::cout;
-        } else if constexpr (std::is_same_v<Char, wchar_t>) {
-            std::wcout << std::vformat(std::forward<Fmt>(fmt), std::make_wformat_args(args...));
-            return std::wcout;
-        } else {
-            static_assert(!std::is_same_v<Char, Char>, "Unsupported type passed to usylibpp::print::print");
-        }
+    template <typename... Ts>
+    inline std::ostream& print(std::format_string<Ts...> fmt, Ts&&... args) {
+        const auto& buf = internal::format<char>(false, fmt, std::forward<Ts>(args)...);
+        return std::cout.write(buf.data(), static_cast<std::streamsize>(buf.size()));
+    }
+
+    template <typename... Ts>
+    inline std::wostream& print(std::wformat_string<Ts...> fmt, Ts&&... args) {
+        const auto& buf = internal::format<wchar_t>(false, fmt, std::forward<Ts>(args)...);
+        return std::wcout.write(buf.data(), static_cast<std::streamsize>(buf.size()));
     }
 
     /**
-     * Will fail silently on mismatched paranthesis and args
-     * Prints to cout or wcout depending on the args passed in
+     * Writes straight to a C stream with one fwrite, skipping iostreams and their sync with stdio
      */
-    template<typename Fmt = const char*, typename... Ts>
-    inline void println(Fmt&& fmt = "", Ts&&... args) {
-        using Char = std::remove_cvref_t<decltype(fmt[0])>;
+    template <typename... Ts>
+    inline void print(std::FILE* stream, std::format_string<Ts...> fmt, Ts&&... args) {
+        const auto& buf = internal::format<char>(false, fmt, std::forward<Ts>(args)...);
+        std::fwrite(buf.data(), 1, buf.size(), stream);
+    }
+
+    /**
+     * Wide text is converted to UTF-8 on the way out, unpaired surrogates drop the whole write
+     */
+    template <typename... Ts>
+    inline void print(std::FILE* stream, std::wformat_string<Ts...> fmt, Ts&&... args) {
+        internal::write_wide(stream, internal::format<wchar_t>(false, fmt, std::forward<Ts>(args)...));
+    }
+
+    inline void println() {
+        std::cout.put('\n');
+    }
+
+    /**
+     * The format string is checked against the args at compile time
+     * The newline goes out in the same write as the rest of the line
+     */
+    template <typename... Ts>
+    inline void println(std::format_string<Ts...> fmt, Ts&&... args) {
+        const auto& buf = internal::format<char>(true, fmt, std::forward<Ts>(args)...);
+        std::cout.write(buf.data(), static_cast<std::streamsize>(buf.size()));
+    }
+
+    template <typename... Ts>
+    inline void println(std::wformat_string<Ts...> fmt, Ts&&... args) {
+        const auto& buf = internal::format<wchar_t>(true, fmt, std::forward<Ts>(args)...);
+        std::wcout.write(buf.data(), static_cast<std::streamsize>(buf.size()));
+    }
+
+    template <typename... Ts>
+    inline void println(std::FILE* stream, std::format_string<Ts...> fmt, Ts&&... args) {
+        const auto& buf = internal::format<char>(true, fmt, std::forward<Ts>(args)...);
+        std::fwrite(buf.data(), 1, buf.size(), stream);
+    }
+
+    template <typename... Ts>
+    inline void println(std::FILE* stream, std::wformat_string<Ts...> fmt, Ts&&... args) {
+        internal::write_wide(stream, internal::format<wchar_t>(true, fmt, std::forward<Ts>(args)...));
+    }
+}
+
+/**
+ * Lets small_string and fixed_string go straight into print and std::format
+ */
+template <size_t N, typename Char>
+struct std::formatter<usylibpp::strings::small_string<N, Char>, Char> : std::formatter<std::basic_string_view<Char>, Char> {
+    auto format(const usylibpp::strings::small_string<N, Char>& str, auto& ctx) const {
+        return std::formatter<std::basic_string_view<Char>, Char>::format(str.view(), ctx);
+    }
+};
 
-        print(fmt, args...) << Char('\n');
+template <size_t N, typename Char>
+struct std::formatter<usylibpp::strings::fixed_string<N, Char>, Char> : std::formatter<std::basic_string_view<Char>, Char> {
+    auto format(const usylibpp::strings::fixed_string<N, Char>& str, auto& ctx) const {
+        return std::formatter<std::basic_string_view<Char>, Char>::format(str.view(), ctx);
     }
-}
\ No newline at end of file
+};
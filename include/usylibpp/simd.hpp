@@ -0,0 +1,330 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+#if !defined(USYLIBPP_NO_SIMD) && defined(__AVX512BW__)
+#define USYLIBPP_SIMD_LEVEL 3
+#elif !defined(USYLIBPP_NO_SIMD) && defined(__AVX2__)
+#define USYLIBPP_SIMD_LEVEL 2
+#elif !defined(USYLIBPP_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64))
+#define USYLIBPP_SIMD_LEVEL 1
+#else
+#define USYLIBPP_SIMD_LEVEL 0
+#endif
+
+#if USYLIBPP_SIMD_LEVEL > 0
+#include <immintrin.h>
+#endif
+
+/**
+ * Byte scanning kernels shared by the string helpers
+ * The widest instruction set enabled for the translation unit is picked at compile time (AVX-512BW, AVX2, SSE2)
+ * Build with -mavx2 / -march=native or /arch:AVX2 to get the wider paths, define USYLIBPP_NO_SIMD to force the scalar fallback
+ */
+namespace usylibpp::simd {
+    #if USYLIBPP_SIMD_LEVEL == 3
+    inline constexpr size_t width = 64;
+    using mask_t = uint64_t;
+    #elif USYLIBPP_SIMD_LEVEL == 2
+    inline constexpr size_t width = 32;
+    using mask_t = uint32_t;
+    #elif USYLIBPP_SIMD_LEVEL == 1
+    inline constexpr size_t width = 16;
+    using mask_t = uint32_t;
+    #else
+    inline constexpr size_t width = 1;
+    using mask_t = uint32_t;
+    #endif
+
+    /**
+     * Bit i is set when p[i] == c, reads exactly width bytes
+     */
+    [[nodiscard]] inline mask_t eq_mask(const char* p, char c) noexcept {
+        #if USYLIBPP_SIMD_LEVEL == 3
+        return _mm512_cmpeq_epi8_mask(_mm512_loadu_si512(p), _mm512_set1_epi8(c));
+        #elif USYLIBPP_SIMD_LEVEL == 2
+        const auto eq = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)), _mm256_set1_epi8(c));
+        return static_cast<mask_t>(_mm256_movemask_epi8(eq));
+        #elif USYLIBPP_SIMD_LEVEL == 1
+        const auto eq = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)), _mm_set1_epi8(c));
+        return static_cast<mask_t>(_mm_movemask_epi8(eq));
+        #else
+        return *p == c;
+        #endif
+    }
+
+    /**
+     * Index of the first byte equal to c, or size if there is none
+     */
+    [[nodiscard]] inline size_t find(const char* data, size_t size, char c) noexcept {
+        const auto* found = static_cast<const char*>(std::memchr(data, c, size));
+        return found ? static_cast<size_t>(found - data) : size;
+    }
+
+    /**
+     * Index of the first occurrence of needle, or size if there is none
+     * Blocks are filtered on the first and last needle byte at once so memcmp only runs on likely candidates
+     */
+    [[nodiscard]] inline size_t find_substring(const char* data, size_t size, const char* needle, size_t needle_size) noexcept {
+        if (needle_size == 0) return 0;
+        if (needle_size > size) return size;
+        if (needle_size == 1) return find(data, size, needle[0]);
+
+        size_t i = 0;
+        if constexpr (width > 1) {
+            const auto first = needle[0];
+            const auto last = needle[needle_size - 1];
+            for (; i + needle_size - 1 + width <= size; i += width) {
+                for (auto mask = eq_mask(data + i, first) & eq_mask(data + i + needle_size - 1, last); mask != 0; mask &= mask - 1) {
+                    const auto pos = i + static_cast<size_t>(std::countr_zero(mask));
+                    if (std::memcmp(data + pos + 1, needle + 1, needle_size - 2) == 0) return pos;
+                }
+            }
+        }
+
+        const auto pos = std::string_view{data + i, size - i}.find(std::string_view{needle, needle_size});
+        return pos == std::string_view::npos ? size : i + pos;
+    }
+
+    /**
+     * Calls f(index) for every byte equal to c, in order
+     */
+    inline void for_each_match(const char* data, size_t size, char c, auto&& f) {
+        size_t i = 0;
+        if constexpr (width > 1) {
+            for (; i + width <= size; i += width) {
+                for (auto mask = eq_mask(data + i, c); mask != 0; mask &= mask - 1) {
+                    f(i + static_cast<size_t>(std::countr_zero(mask)));
+                }
+            }
+        }
+        while (i < size) {
+            const auto next = i + find(data + i, size - i, c);
+            if (next == size) break;
+            f(next);
+            i = next + 1;
+        }
+    }
+
+    /**
+     * Bit i is set when p[i] is not ASCII, reads exactly width bytes
+     */
+    [[nodiscard]] inline mask_t non_ascii_mask(const char* p) noexcept {
+        #if USYLIBPP_SIMD_LEVEL == 3
+        return _mm512_movepi8_mask(_mm512_loadu_si512(p));
+        #elif USYLIBPP_SIMD_LEVEL == 2
+        return static_cast<mask_t>(_mm256_movemask_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p))));
+        #elif USYLIBPP_SIMD_LEVEL == 1
+        return static_cast<mask_t>(_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))));
+        #else
+        return static_cast<unsigned char>(*p) >> 7;
+        #endif
+    }
+
+    /**
+     * Index of the first byte >= 0x80, or size if the whole range is ASCII
+     */
+    [[nodiscard]] inline size_t find_non_ascii(const char* data, size_t size) noexcept {
+        size_t i = 0;
+        if constexpr (width > 1) {
+            for (; i + width <= size; i += width) {
+                if (const auto mask = non_ascii_mask(data + i)) return i + static_cast<size_t>(std::countr_zero(mask));
+            }
+        }
+        for (; i < size; ++i) {
+            if (static_cast<unsigned char>(data[i]) >= 0x80) return i;
+        }
+        return size;
+    }
+
+    /**
+     * Locale independent ASCII case conversion from src to dst, which may alias
+     * Upper selects uppercase, bytes outside [A-Z] / [a-z] are copied unchanged
+     */
+    template <bool Upper>
+    inline void ascii_case(const char* src, char* dst, size_t size) noexcept {
+        constexpr char first = Upper ? 'a' : 'A';
+        size_t i = 0;
+        #if USYLIBPP_SIMD_LEVEL == 3
+        for (; i + width <= size; i += width) {
+            const auto x = _mm512_loadu_si512(src + i);
+            const auto in_range = _mm512_cmplt_epu8_mask(_mm512_sub_epi8(x, _mm512_set1_epi8(first)), _mm512_set1_epi8(26));
+            _mm512_storeu_si512(dst + i, _mm512_mask_blend_epi8(in_range, x, _mm512_xor_si512(x, _mm512_set1_epi8(0x20))));
+        }
+        #elif USYLIBPP_SIMD_LEVEL == 2
+        for (; i + width <= size; i += width) {
+            const auto x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+            // shift [first, first + 26) down to the bottom of the signed range so one signed compare finds it
+            const auto shifted = _mm256_add_epi8(x, _mm256_set1_epi8(static_cast<char>(0x80 - first)));
+            const auto in_range = _mm256_cmpgt_epi8(_mm256_set1_epi8(static_cast<char>(-128 + 26)), shifted);
+            const auto flipped = _mm256_xor_si256(x, _mm256_and_si256(in_range, _mm256_set1_epi8(0x20)));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), flipped);
+        }
+        #elif USYLIBPP_SIMD_LEVEL == 1
+        for (; i + width <= size; i += width) {
+            const auto x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+            // shift [first, first + 26) down to the bottom of the signed range so one signed compare finds it
+            const auto shifted = _mm_add_epi8(x, _mm_set1_epi8(static_cast<char>(0x80 - first)));
+            const auto in_range = _mm_cmpgt_epi8(_mm_set1_epi8(static_cast<char>(-128 + 26)), shifted);
+            const auto flipped = _mm_xor_si128(x, _mm_and_si128(in_range, _mm_set1_epi8(0x20)));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), flipped);
+        }
+        #endif
+        for (; i < size; ++i) {
+            const auto c = static_cast<unsigned char>(src[i]);
+            dst[i] = static_cast<char>(static_cast<unsigned char>(c - first) < 26 ? c ^ 0x20 : c);
+        }
+    }
+
+    [[nodiscard]] inline size_t count(const char* data, size_t size, char c) noexcept {
+        size_t total = 0;
+        size_t i = 0;
+        if constexpr (width > 1) {
+            for (; i + width <= size; i += width) {
+                total += static_cast<size_t>(std::popcount(eq_mask(data + i, c)));
+            }
+        }
+        for (; i < size; ++i) total += data[i] == c;
+        return total;
+    }
+
+    /**
+     * Zero extends size ASCII bytes into 16 or 32 bit code units
+     */
+    template <typename Unit>
+    inline void widen_ascii(const char* src, Unit* dst, size_t size) noexcept {
+        static_assert(sizeof(Unit) == 2 || sizeof(Unit) == 4);
+        size_t i = 0;
+        #if USYLIBPP_SIMD_LEVEL > 0
+        const auto zero = _mm_setzero_si128();
+        for (; i + 32 <= size; i += 32) {
+            for (size_t half = 0; half < 32; half += 16) {
+                const auto x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + half));
+                const auto lo = _mm_unpacklo_epi8(x, zero);
+                const auto hi = _mm_unpackhi_epi8(x, zero);
+                auto* out = reinterpret_cast<__m128i*>(dst + i + half);
+                if constexpr (sizeof(Unit) == 2) {
+                    _mm_storeu_si128(out, lo);
+                    _mm_storeu_si128(out + 1, hi);
+                } else {
+                    _mm_storeu_si128(out, _mm_unpacklo_epi16(lo, zero));
+                    _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(lo, zero));
+                    _mm_storeu_si128(out + 2, _mm_unpacklo_epi16(hi, zero));
+                    _mm_storeu_si128(out + 3, _mm_unpackhi_epi16(hi, zero));
+                }
+            }
+        }
+        #endif
+        for (; i < size; ++i) dst[i] = static_cast<Unit>(static_cast<unsigned char>(src[i]));
+    }
+
+    /**
+     * Narrows leading code units below 0x80 into dst, stops at the first one that is not
+     * Returns how many were converted, with dst as nullptr they are only counted
+     */
+    template <typename Unit>
+    [[nodiscard]] inline size_t narrow_ascii(const Unit* src, char* dst, size_t size) noexcept {
+        static_assert(sizeof(Unit) == 2 || sizeof(Unit) == 4);
+        size_t i = 0;
+        #if USYLIBPP_SIMD_LEVEL > 0
+        if constexpr (sizeof(Unit) == 2) {
+            const auto high_bits = _mm_set1_epi16(static_cast<short>(0xFF80));
+            const auto zero = _mm_setzero_si128();
+            for (; i + 16 <= size; i += 16) {
+                const auto a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+                const auto b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 8));
+                const auto ascii = _mm_cmpeq_epi16(_mm_and_si128(_mm_or_si128(a, b), high_bits), zero);
+                if (_mm_movemask_epi8(ascii) != 0xFFFF) break;
+                if (dst) _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(a, b));
+            }
+        }
+        #endif
+        for (; i < size && static_cast<uint32_t>(src[i]) < 0x80; ++i) {
+            if (dst) dst[i] = static_cast<char>(src[i]);
+        }
+        return i;
+    }
+
+    /**
+     * Number of UTF-8 continuation bytes (10xxxxxx) in the range
+     */
+    [[nodiscard]] inline size_t count_continuation(const char* data, size_t size) noexcept {
+        size_t total = 0;
+        size_t i = 0;
+        #if USYLIBPP_SIMD_LEVEL == 3
+        for (; i + width <= size; i += width) {
+            // continuation bytes are exactly the signed values below -64
+            total += static_cast<size_t>(std::popcount(_mm512_cmplt_epi8_mask(_mm512_loadu_si512(data + i), _mm512_set1_epi8(-64))));
+        }
+        #elif USYLIBPP_SIMD_LEVEL == 2
+        for (; i + width <= size; i += width) {
+            const auto x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+            total += static_cast<size_t>(std::popcount(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpgt_epi8(_mm256_set1_epi8(-64), x)))));
+        }
+        #elif USYLIBPP_SIMD_LEVEL == 1
+        for (; i + width <= size; i += width) {
+            const auto x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+            total += static_cast<size_t>(std::popcount(static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(-64), x)))));
+        }
+        #endif
+        for (; i < size; ++i) total += (static_cast<unsigned char>(data[i]) & 0xC0) == 0x80;
+        return total;
+    }
+
+    #if USYLIBPP_SIMD_LEVEL == 0
+    namespace internal {
+        /**
+         * Packs the top bit of each byte of a little endian word into 8 bits, every other bit must be clear
+         */
+        [[nodiscard]] inline uint32_t gather_high_bits(const uint64_t x) noexcept {
+            if constexpr (std::endian::native == std::endian::little) {
+                return static_cast<uint32_t>(((x >> 7) * 0x0102040810204080ull) >> 56);
+            } else {
+                uint32_t mask = 0;
+                for (size_t i = 0; i < 8; ++i) mask |= static_cast<uint32_t>((x >> (8 * i + 7)) & 1) << i;
+                return mask;
+            }
+        }
+    }
+    #endif
+
+    /**
+     * Bit i is set when p[i] == c for the 16 bytes at p, the group size of hash table control bytes
+     * Stays on SSE2 at every level so the mask width does not depend on the build flags
+     */
+    [[nodiscard]] inline uint32_t eq_mask16(const char* p, const char c) noexcept {
+        #if USYLIBPP_SIMD_LEVEL > 0
+        const auto eq = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)), _mm_set1_epi8(c));
+        return static_cast<uint32_t>(_mm_movemask_epi8(eq));
+        #else
+        constexpr uint64_t low7 = 0x7F7F7F7F7F7F7F7Full;
+        const auto half = [&](const char* q) {
+            uint64_t x;
+            std::memcpy(&x, q, sizeof(x));
+            x ^= 0x0101010101010101ull * static_cast<unsigned char>(c);
+            // exact zero byte test, 0x80 in every byte of x that is zero
+            return internal::gather_high_bits(~(((x & low7) + low7) | x | low7));
+        };
+        return half(p) | (half(p + 8) << 8);
+        #endif
+    }
+
+    /**
+     * Bit i is set when p[i] has its top bit set, for the 16 bytes at p
+     */
+    [[nodiscard]] inline uint32_t high_bit_mask16(const char* p) noexcept {
+        #if USYLIBPP_SIMD_LEVEL > 0
+        return static_cast<uint32_t>(_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))));
+        #else
+        uint64_t low;
+        uint64_t high;
+        std::memcpy(&low, p, sizeof(low));
+        std::memcpy(&high, p + 8, sizeof(high));
+        return internal::gather_high_bits(low & 0x8080808080808080ull) | (internal::gather_high_bits(high & 0x8080808080808080ull) << 8);
+        #endif
+    }
+}
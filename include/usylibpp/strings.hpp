@@ -1,17 +1,36 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <string>
 #include <string_view>
+#include <bit>
+#include <concepts>
 #include <cstring>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <initializer_list>
 #include <charconv>
+#include <limits>
+#include <optional>
+#include <type_traits>
+#include <vector>
 #include "types.hpp"
+#include "parallel.hpp"
+#include "simd.hpp"
+#include "unicode.hpp"
 
-#ifdef WIN32
-namespace usylibpp::windows {
-    std::optional<std::wstring> to_wstr(const char* utf8);
-    std::optional<std::wstring> to_wstr(const std::string& utf8);
-}
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
 #endif
 
 namespace usylibpp::strings {
@@ -26,28 +45,182 @@ namespace usylibpp::strings {
         }
     }
 
-    #ifdef WIN32
     /**
-     * If its a string type this pointer will only survive to the next call on the thread
+     * Functions handing out views into per thread storage rotate through this many slots,
+     * so a view survives the next view_slots - 1 calls on the same thread
+     */
+    inline constexpr size_t view_slots = 8;
+
+    namespace internal {
+        template <typename Slot>
+        [[nodiscard]] inline Slot& next_slot() noexcept {
+            static thread_local Slot slots[view_slots]{};
+            static thread_local size_t next = 0;
+            return slots[next++ % view_slots];
+        }
+
+        [[nodiscard]] inline const wchar_t* wide_slot(const std::string_view utf8) {
+            const auto length = unicode::wstring_length(utf8);
+            if (!length) return L"";
+
+            auto& slot = next_slot<std::wstring>();
+            slot.resize(*length);
+            (void) unicode::to_wstring_into(utf8, slot);
+            return slot.c_str();
+        }
+    }
+
+    /**
+     * If its a string type the pointer lives in a per thread ring and survives the next view_slots - 1 calls on the thread
+     * Narrow strings are read as UTF-8, invalid input gives an empty string
      */
     template<types::wchar_t_compatible T>
     [[nodiscard]] inline const wchar_t* wchar_t_from_compatible(T&& str) {
         if constexpr (types::wchar_t_strict<T>) {
             return wchar_t_from_strict(std::forward<T>(str));
         } else if constexpr (types::string<T>) {
-            static thread_local std::optional<std::wstring> buffer;
-            buffer = windows::to_wstr(str);
-            if (!buffer) return L"";
-            return buffer->c_str();
+            return internal::wide_slot(str);
         } else if constexpr (types::filesystem_path<T>) {
+            #ifdef WIN32
             return str.native().c_str();
+            #else
+            return internal::wide_slot(str.native());
+            #endif
         } else {
             static_assert(!std::is_same_v<T, T>, "Unsupported type passed to usylibpp::strings::wchar_t_from_compatible, must have forgotten a branch");
         }
     }
-    #endif
+
+    /**
+     * Bump allocator for short lived strings, built on std::pmr::monotonic_buffer_resource
+     * Views handed out by the arena overloads below stay valid until reset or destruction, reset frees everything at once
+     */
+    class arena {
+    private:
+        std::pmr::monotonic_buffer_resource upstream;
+        size_t used = 0;
+    public:
+        static constexpr size_t default_initial_size = 4096;
+
+        explicit arena(const size_t initial_size = default_initial_size) : upstream(initial_size) {}
+
+        /**
+         * Allocates from buffer first, buffer has to outlive the arena
+         */
+        explicit arena(const std::span<std::byte> buffer) : upstream(buffer.data(), buffer.size()) {}
+
+        arena(const arena&) = delete;
+        arena& operator=(const arena&) = delete;
+
+        template <typename Char = char>
+        [[nodiscard]] Char* allocate(const size_t count) {
+            used += count * sizeof(Char);
+            return static_cast<Char*>(upstream.allocate(count * sizeof(Char), alignof(Char)));
+        }
+
+        template <typename Char>
+        [[nodiscard]] std::basic_string_view<Char> copy(const std::basic_string_view<Char> str) {
+            Char* dest = allocate<Char>(str.size());
+            std::memcpy(dest, str.data(), str.size() * sizeof(Char));
+            return {dest, str.size()};
+        }
+
+        [[nodiscard]] std::string_view copy(const std::string_view str) {
+            return copy<char>(str);
+        }
+
+        /**
+         * Invalidates every view handed out so far
+         */
+        void reset() noexcept {
+            upstream.release();
+            used = 0;
+        }
+
+        /**
+         * Bytes handed out since the last reset, not counting what the resource holds in reserve
+         */
+        [[nodiscard]] size_t bytes_used() const noexcept {
+            return used;
+        }
+
+        /**
+         * For std::pmr containers that should share the arena
+         */
+        [[nodiscard]] std::pmr::memory_resource* resource() noexcept {
+            return &upstream;
+        }
+    };
+
+    /**
+     * String of exactly N characters plus a terminator, usable as a constexpr value and as a template argument
+     * Members are public so it stays a structural type
+     */
+    template <size_t N, typename Char = char>
+    struct fixed_string {
+        Char chars[N + 1]{};
+
+        constexpr fixed_string() noexcept = default;
+
+        constexpr fixed_string(const Char (&str)[N + 1]) noexcept {
+            std::copy_n(str, N + 1, chars);
+        }
+
+        [[nodiscard]] static constexpr size_t size() noexcept {
+            return N;
+        }
+
+        [[nodiscard]] static constexpr bool empty() noexcept {
+            return N == 0;
+        }
+
+        [[nodiscard]] constexpr const Char* data() const noexcept {
+            return chars;
+        }
+
+        [[nodiscard]] constexpr const Char* c_str() const noexcept {
+            return chars;
+        }
+
+        [[nodiscard]] constexpr const Char* begin() const noexcept {
+            return chars;
+        }
+
+        [[nodiscard]] constexpr const Char* end() const noexcept {
+            return chars + N;
+        }
+
+        [[nodiscard]] constexpr Char operator[](const size_t i) const noexcept {
+            return chars[i];
+        }
+
+        [[nodiscard]] constexpr std::basic_string_view<Char> view() const noexcept {
+            return {chars, N};
+        }
+
+        constexpr operator std::basic_string_view<Char>() const noexcept {
+            return view();
+        }
+
+        template <size_t M>
+        [[nodiscard]] constexpr bool operator==(const fixed_string<M, Char>& other) const noexcept {
+            return view() == other.view();
+        }
+    };
+
+    template <typename Char, size_t N>
+    fixed_string(const Char (&)[N]) -> fixed_string<N - 1, Char>;
+
+    namespace internal {
+        template <typename T>
+        inline constexpr bool is_fixed_string = false;
+
+        template <size_t N, typename Char>
+        inline constexpr bool is_fixed_string<fixed_string<N, Char>> = true;
+    }
 
     template<typename... Ts>
+    requires (!(internal::is_fixed_string<std::remove_cvref_t<Ts>> && ...))
     [[nodiscard]] inline constexpr auto concat_strings(Ts&&... parts) {
         using First = decltype(([](auto&& first, auto&&...) -> auto&& { return first; })(parts...));
         using Char = std::remove_cvref_t<decltype(std::declval<First>()[0])>;
@@ -62,31 +235,433 @@ namespace usylibpp::strings {
         return result;
     }
 
+    /**
+     * Same as concat_strings but the result lives in the arena
+     */
+    template<typename... Ts>
+    [[nodiscard]] inline auto concat_strings(arena& arena, Ts&&... parts) {
+        using First = decltype(([](auto&& first, auto&&...) -> auto&& { return first; })(parts...));
+        using Char = std::remove_cvref_t<decltype(std::declval<First>()[0])>;
+
+        const auto size = (std::basic_string_view<Char>(parts).size() + ... + 0);
+        Char* const result = arena.template allocate<Char>(size);
+
+        Char* dest = result;
+        std::basic_string_view<Char> sv;
+        ((sv = std::basic_string_view<Char>(parts), memcpy(dest, sv.data(), sv.size() * sizeof(Char)), dest += sv.size()), ...);
+
+        return std::basic_string_view<Char>{result, size};
+    }
+
+    /**
+     * All parts are fixed_strings so the size is known up front, the result is a fixed_string and never touches the heap
+     * In a constant expression the whole concatenation happens at compile time
+     */
+    template <typename Char, size_t... Ns>
+    [[nodiscard]] inline constexpr fixed_string<(Ns + ... + 0), Char> concat_strings(const fixed_string<Ns, Char>&... parts) noexcept {
+        fixed_string<(Ns + ... + 0), Char> result;
+        Char* dest = result.chars;
+        ((dest = std::copy_n(parts.chars, Ns, dest)), ...);
+        return result;
+    }
+
+    /**
+     * Concatenation of string literals done at compile time into static storage
+     * concat_v<"Content-Type: ", "text/plain"> is a fixed_string, view() or the string_view conversion gives the text
+     */
+    template <fixed_string... Parts>
+    inline constexpr auto concat_v = concat_strings(Parts...);
+
+    /**
+     * Appends every part to out, growing it exactly once
+     */
+    template <typename Char, typename... Ts>
+    inline void concat_into(std::basic_string<Char>& out, Ts&&... parts) {
+        const auto offset = out.size();
+        out.resize(offset + (std::basic_string_view<Char>(parts).size() + ... + 0));
+
+        Char* dest = out.data() + offset;
+        std::basic_string_view<Char> sv;
+        ((sv = std::basic_string_view<Char>(parts), memcpy(dest, sv.data(), sv.size() * sizeof(Char)), dest += sv.size()), ...);
+    }
+
+    /**
+     * ascii only maps [A-Z] / [a-z] and never depends on the global locale
+     * utf8 applies Unicode 14 simple case folding (CaseFolding.txt statuses C and S), so the output can be compared
+     * byte for byte, invalid sequences are copied through unchanged
+     */
+    enum class case_mode {
+        ascii,
+        utf8
+    };
+
+    namespace internal {
+        /**
+         * Code points in [first, last] fold to c + delta, step 2 only covers those with the same parity as first
+         */
+        struct fold_range {
+            char32_t first;
+            char32_t last;
+            int32_t delta;
+            uint8_t step;
+        };
+
+        inline constexpr fold_range fold_ranges[] = {
+            {0x41, 0x5A, 0x20, 1}, {0xB5, 0xB5, 0x307, 1}, {0xC0, 0xD6, 0x20, 1}, {0xD8, 0xDE, 0x20, 1}, {0x100, 0x12E, 0x1, 2}, {0x132, 0x136, 0x1, 2}, {0x139, 0x147, 0x1, 2},
+            {0x14A, 0x176, 0x1, 2}, {0x178, 0x178, -0x79, 1}, {0x179, 0x17D, 0x1, 2}, {0x17F, 0x17F, -0x10C, 1}, {0x181, 0x181, 0xD2, 1}, {0x182, 0x184, 0x1, 2}, {0x186, 0x186, 0xCE, 1},
+            {0x187, 0x187, 0x1, 1}, {0x189, 0x18A, 0xCD, 1}, {0x18B, 0x18B, 0x1, 1}, {0x18E, 0x18E, 0x4F, 1}, {0x18F, 0x18F, 0xCA, 1}, {0x190, 0x190, 0xCB, 1}, {0x191, 0x191, 0x1, 1},
+            {0x193, 0x193, 0xCD, 1}, {0x194, 0x194, 0xCF, 1}, {0x196, 0x196, 0xD3, 1}, {0x197, 0x197, 0xD1, 1}, {0x198, 0x198, 0x1, 1}, {0x19C, 0x19C, 0xD3, 1}, {0x19D, 0x19D, 0xD5, 1},
+            {0x19F, 0x19F, 0xD6, 1}, {0x1A0, 0x1A4, 0x1, 2}, {0x1A6, 0x1A6, 0xDA, 1}, {0x1A7, 0x1A7, 0x1, 1}, {0x1A9, 0x1A9, 0xDA, 1}, {0x1AC, 0x1AC, 0x1, 1}, {0x1AE, 0x1AE, 0xDA, 1},
+            {0x1AF, 0x1AF, 0x1, 1}, {0x1B1, 0x1B2, 0xD9, 1}, {0x1B3, 0x1B5, 0x1, 2}, {0x1B7, 0x1B7, 0xDB, 1}, {0x1B8, 0x1B8, 0x1, 1}, {0x1BC, 0x1BC, 0x1, 1}, {0x1C4, 0x1C4, 0x2, 1},
+            {0x1C5, 0x1C5, 0x1, 1}, {0x1C7, 0x1C7, 0x2, 1}, {0x1C8, 0x1C8, 0x1, 1}, {0x1CA, 0x1CA, 0x2, 1}, {0x1CB, 0x1DB, 0x1, 2}, {0x1DE, 0x1EE, 0x1, 2}, {0x1F1, 0x1F1, 0x2, 1},
+            {0x1F2, 0x1F4, 0x1, 2}, {0x1F6, 0x1F6, -0x61, 1}, {0x1F7, 0x1F7, -0x38, 1}, {0x1F8, 0x21E, 0x1, 2}, {0x220, 0x220, -0x82, 1}, {0x222, 0x232, 0x1, 2}, {0x23A, 0x23A, 0x2A2B, 1},
+            {0x23B, 0x23B, 0x1, 1}, {0x23D, 0x23D, -0xA3, 1}, {0x23E, 0x23E, 0x2A28, 1}, {0x241, 0x241, 0x1, 1}, {0x243, 0x243, -0xC3, 1}, {0x244, 0x244, 0x45, 1}, {0x245, 0x245, 0x47, 1},
+            {0x246, 0x24E, 0x1, 2}, {0x345, 0x345, 0x74, 1}, {0x370, 0x372, 0x1, 2}, {0x376, 0x376, 0x1, 1}, {0x37F, 0x37F, 0x74, 1}, {0x386, 0x386, 0x26, 1}, {0x388, 0x38A, 0x25, 1},
+            {0x38C, 0x38C, 0x40, 1}, {0x38E, 0x38F, 0x3F, 1}, {0x391, 0x3A1, 0x20, 1}, {0x3A3, 0x3AB, 0x20, 1}, {0x3C2, 0x3C2, 0x1, 1}, {0x3CF, 0x3CF, 0x8, 1}, {0x3D0, 0x3D0, -0x1E, 1},
+            {0x3D1, 0x3D1, -0x19, 1}, {0x3D5, 0x3D5, -0xF, 1}, {0x3D6, 0x3D6, -0x16, 1}, {0x3D8, 0x3EE, 0x1, 2}, {0x3F0, 0x3F0, -0x36, 1}, {0x3F1, 0x3F1, -0x30, 1}, {0x3F4, 0x3F4, -0x3C, 1},
+            {0x3F5, 0x3F5, -0x40, 1}, {0x3F7, 0x3F7, 0x1, 1}, {0x3F9, 0x3F9, -0x7, 1}, {0x3FA, 0x3FA, 0x1, 1}, {0x3FD, 0x3FF, -0x82, 1}, {0x400, 0x40F, 0x50, 1}, {0x410, 0x42F, 0x20, 1},
+            {0x460, 0x480, 0x1, 2}, {0x48A, 0x4BE, 0x1, 2}, {0x4C0, 0x4C0, 0xF, 1}, {0x4C1, 0x4CD, 0x1, 2}, {0x4D0, 0x52E, 0x1, 2}, {0x531, 0x556, 0x30, 1}, {0x10A0, 0x10C5, 0x1C60, 1},
+            {0x10C7, 0x10C7, 0x1C60, 1}, {0x10CD, 0x10CD, 0x1C60, 1}, {0x13F8, 0x13FD, -0x8, 1}, {0x1C80, 0x1C80, -0x184E, 1}, {0x1C81, 0x1C81, -0x184D, 1}, {0x1C82, 0x1C82, -0x1844, 1}, {0x1C83, 0x1C84, -0x1842, 1},
+            {0x1C85, 0x1C85, -0x1843, 1}, {0x1C86, 0x1C86, -0x183C, 1}, {0x1C87, 0x1C87, -0x1824, 1}, {0x1C88, 0x1C88, 0x89C3, 1}, {0x1C90, 0x1CBA, -0xBC0, 1}, {0x1CBD, 0x1CBF, -0xBC0, 1}, {0x1E00, 0x1E94, 0x1, 2},
+            {0x1E9B, 0x1E9B, -0x3A, 1}, {0x1E9E, 0x1E9E, -0x1DBF, 1}, {0x1EA0, 0x1EFE, 0x1, 2}, {0x1F08, 0x1F0F, -0x8, 1}, {0x1F18, 0x1F1D, -0x8, 1}, {0x1F28, 0x1F2F, -0x8, 1}, {0x1F38, 0x1F3F, -0x8, 1},
+            {0x1F48, 0x1F4D, -0x8, 1}, {0x1F59, 0x1F5F, -0x8, 2}, {0x1F68, 0x1F6F, -0x8, 1}, {0x1F88, 0x1F8F, -0x8, 1}, {0x1F98, 0x1F9F, -0x8, 1}, {0x1FA8, 0x1FAF, -0x8, 1}, {0x1FB8, 0x1FB9, -0x8, 1},
+            {0x1FBA, 0x1FBB, -0x4A, 1}, {0x1FBC, 0x1FBC, -0x9, 1}, {0x1FBE, 0x1FBE, -0x1C05, 1}, {0x1FC8, 0x1FCB, -0x56, 1}, {0x1FCC, 0x1FCC, -0x9, 1}, {0x1FD8, 0x1FD9, -0x8, 1}, {0x1FDA, 0x1FDB, -0x64, 1},
+            {0x1FE8, 0x1FE9, -0x8, 1}, {0x1FEA, 0x1FEB, -0x70, 1}, {0x1FEC, 0x1FEC, -0x7, 1}, {0x1FF8, 0x1FF9, -0x80, 1}, {0x1FFA, 0x1FFB, -0x7E, 1}, {0x1FFC, 0x1FFC, -0x9, 1}, {0x2126, 0x2126, -0x1D5D, 1},
+            {0x212A, 0x212A, -0x20BF, 1}, {0x212B, 0x212B, -0x2046, 1}, {0x2132, 0x2132, 0x1C, 1}, {0x2160, 0x216F, 0x10, 1}, {0x2183, 0x2183, 0x1, 1}, {0x24B6, 0x24CF, 0x1A, 1}, {0x2C00, 0x2C2F, 0x30, 1},
+            {0x2C60, 0x2C60, 0x1, 1}, {0x2C62, 0x2C62, -0x29F7, 1}, {0x2C63, 0x2C63, -0xEE6, 1}, {0x2C64, 0x2C64, -0x29E7, 1}, {0x2C67, 0x2C6B, 0x1, 2}, {0x2C6D, 0x2C6D, -0x2A1C, 1}, {0x2C6E, 0x2C6E, -0x29FD, 1},
+            {0x2C6F, 0x2C6F, -0x2A1F, 1}, {0x2C70, 0x2C70, -0x2A1E, 1}, {0x2C72, 0x2C72, 0x1, 1}, {0x2C75, 0x2C75, 0x1, 1}, {0x2C7E, 0x2C7F, -0x2A3F, 1}, {0x2C80, 0x2CE2, 0x1, 2}, {0x2CEB, 0x2CED, 0x1, 2},
+            {0x2CF2, 0x2CF2, 0x1, 1}, {0xA640, 0xA66C, 0x1, 2}, {0xA680, 0xA69A, 0x1, 2}, {0xA722, 0xA72E, 0x1, 2}, {0xA732, 0xA76E, 0x1, 2}, {0xA779, 0xA77B, 0x1, 2}, {0xA77D, 0xA77D, -0x8A04, 1},
+            {0xA77E, 0xA786, 0x1, 2}, {0xA78B, 0xA78B, 0x1, 1}, {0xA78D, 0xA78D, -0xA528, 1}, {0xA790, 0xA792, 0x1, 2}, {0xA796, 0xA7A8, 0x1, 2}, {0xA7AA, 0xA7AA, -0xA544, 1}, {0xA7AB, 0xA7AB, -0xA54F, 1},
+            {0xA7AC, 0xA7AC, -0xA54B, 1}, {0xA7AD, 0xA7AD, -0xA541, 1}, {0xA7AE, 0xA7AE, -0xA544, 1}, {0xA7B0, 0xA7B0, -0xA512, 1}, {0xA7B1, 0xA7B1, -0xA52A, 1}, {0xA7B2, 0xA7B2, -0xA515, 1}, {0xA7B3, 0xA7B3, 0x3A0, 1},
+            {0xA7B4, 0xA7C2, 0x1, 2}, {0xA7C4, 0xA7C4, -0x30, 1}, {0xA7C5, 0xA7C5, -0xA543, 1}, {0xA7C6, 0xA7C6, -0x8A38, 1}, {0xA7C7, 0xA7C9, 0x1, 2}, {0xA7D0, 0xA7D0, 0x1, 1}, {0xA7D6, 0xA7D8, 0x1, 2},
+            {0xA7F5, 0xA7F5, 0x1, 1}, {0xAB70, 0xABBF, -0x97D0, 1}, {0xFF21, 0xFF3A, 0x20, 1}, {0x10400, 0x10427, 0x28, 1}, {0x104B0, 0x104D3, 0x28, 1}, {0x10570, 0x1057A, 0x27, 1}, {0x1057C, 0x1058A, 0x27, 1},
+            {0x1058C, 0x10592, 0x27, 1}, {0x10594, 0x10595, 0x27, 1}, {0x10C80, 0x10CB2, 0x40, 1}, {0x118A0, 0x118BF, 0x20, 1}, {0x16E40, 0x16E5F, 0x20, 1}, {0x1E900, 0x1E921, 0x22, 1}
+        };
+
+        [[nodiscard]] inline constexpr char32_t fold_code_point(const char32_t c) noexcept {
+            const auto it = std::upper_bound(std::begin(fold_ranges), std::end(fold_ranges), c, [](const char32_t value, const fold_range& range) {
+                return value < range.first;
+            });
+            if (it == std::begin(fold_ranges)) return c;
+
+            const auto& range = *(it - 1);
+            if (c > range.last || (range.step == 2 && ((c - range.first) & 1))) return c;
+            return static_cast<char32_t>(static_cast<int32_t>(c) + range.delta);
+        }
+
+        /**
+         * Case folds src into dst, writing only what fits in capacity
+         * Returns the full folded length, which is larger than capacity if the output did not fit
+         */
+        inline constexpr size_t fold_utf8(const std::string_view src, char* dst, const size_t capacity) noexcept {
+            size_t written = 0;
+            size_t i = 0;
+            while (i < src.size()) {
+                size_t run = 0;
+                if (!std::is_constant_evaluated()) {
+                    run = simd::find_non_ascii(src.data() + i, src.size() - i);
+                } else {
+                    while (i + run < src.size() && static_cast<unsigned char>(src[i + run]) < 0x80) ++run;
+                }
+
+                if (run > 0) {
+                    const auto fits = written < capacity ? std::min(run, capacity - written) : 0;
+                    if (!std::is_constant_evaluated()) {
+                        if (fits > 0) simd::ascii_case<false>(src.data() + i, dst + written, fits);
+                    } else {
+                        for (size_t j = 0; j < fits; ++j) {
+                            const auto c = src[i + j];
+                            dst[written + j] = c >= 'A' && c <= 'Z' ? static_cast<char>(c + ('a' - 'A')) : c;
+                        }
+                    }
+                    written += run;
+                    i += run;
+                    if (i == src.size()) break;
+                }
+
+                char32_t c = 0;
+                const auto length = unicode::decode_utf8(src.data() + i, src.size() - i, c);
+                char encoded[4] = {src[i]};
+                size_t encoded_length = 1;
+                if (length == 0) {
+                    ++i;
+                } else {
+                    encoded_length = unicode::encode_utf8(fold_code_point(c), encoded);
+                    i += length;
+                }
+
+                if (written + encoded_length <= capacity) std::copy_n(encoded, encoded_length, dst + written);
+                written += encoded_length;
+            }
+            return written;
+        }
+    }
+
     inline constexpr void to_lowercase_inplace(std::string& str) {
-        std::transform(str.begin(), str.end(), str.begin(), [](unsigned char c) -> char { return static_cast<char>(std::tolower(c)); });
+        if (!std::is_constant_evaluated()) {
+            simd::ascii_case<false>(str.data(), str.data(), str.size());
+            return;
+        }
+        for (auto& c : str) if (c >= 'A' && c <= 'Z') c += 'a' - 'A';
     }
 
+    inline constexpr void to_uppercase_inplace(std::string& str) {
+        if (!std::is_constant_evaluated()) {
+            simd::ascii_case<true>(str.data(), str.data(), str.size());
+            return;
+        }
+        for (auto& c : str) if (c >= 'a' && c <= 'z') c -= 'a' - 'A';
+    }
+
+    template <case_mode Mode = case_mode::ascii>
     [[nodiscard]] inline constexpr std::string to_lowercase(const std::string_view str) {
+        if constexpr (Mode == case_mode::utf8) {
+            std::string ret(str.size(), '\0');
+            const auto length = internal::fold_utf8(str, ret.data(), ret.size());
+            if (length > ret.size()) {
+                ret.resize(length);
+                internal::fold_utf8(str, ret.data(), ret.size());
+            }
+            ret.resize(length);
+            return ret;
+        } else {
+            std::string ret{str};
+            to_lowercase_inplace(ret);
+            return ret;
+        }
+    }
+
+    /**
+     * Same as to_lowercase but the result lives in the arena
+     */
+    template <case_mode Mode = case_mode::ascii>
+    [[nodiscard]] inline std::string_view to_lowercase(arena& arena, const std::string_view str) {
+        if constexpr (Mode == case_mode::utf8) {
+            const auto length = internal::fold_utf8(str, nullptr, 0);
+            char* dest = arena.allocate(length);
+            internal::fold_utf8(str, dest, length);
+            return {dest, length};
+        } else {
+            char* dest = arena.allocate(str.size());
+            simd::ascii_case<false>(str.data(), dest, str.size());
+            return {dest, str.size()};
+        }
+    }
+
+    [[nodiscard]] inline constexpr std::string to_uppercase(const std::string_view str) {
         std::string ret{str};
-        to_lowercase_inplace(ret);
+        to_uppercase_inplace(ret);
         return ret;
     }
 
-    inline constexpr void replace_all_inplace(std::string& str, const std::string_view from, const std::string_view to) {
-        size_t start_pos = 0;
-        while ((start_pos = str.find(from, start_pos)) != std::string::npos) {
-            str.replace(start_pos, from.length(), to);
-            start_pos += to.length();
+    /**
+     * Writes into out instead of allocating, returns the written part of out or std::nullopt if it does not fit
+     * ascii output is always exactly str.size() bytes, utf8 output can be shorter or longer
+     */
+    template <case_mode Mode = case_mode::ascii>
+    [[nodiscard]] inline std::optional<std::string_view> to_lowercase_into(const std::string_view str, const std::span<char> out) noexcept {
+        if constexpr (Mode == case_mode::utf8) {
+            const auto length = internal::fold_utf8(str, out.data(), out.size());
+            if (length > out.size()) return std::nullopt;
+            return std::string_view{out.data(), length};
+        } else {
+            if (str.size() > out.size()) return std::nullopt;
+            simd::ascii_case<false>(str.data(), out.data(), str.size());
+            return std::string_view{out.data(), str.size()};
         }
     }
 
+    [[nodiscard]] inline std::optional<std::string_view> to_uppercase_into(const std::string_view str, const std::span<char> out) noexcept {
+        if (str.size() > out.size()) return std::nullopt;
+        simd::ascii_case<true>(str.data(), out.data(), str.size());
+        return std::string_view{out.data(), str.size()};
+    }
+
+    namespace internal {
+        /**
+         * Calls f(index) for every non overlapping occurrence of from, left to right, from must not be empty
+         */
+        inline void for_each_occurrence(const std::string_view str, const std::string_view from, auto&& f) {
+            size_t pos = 0;
+            while (pos < str.size()) {
+                const auto found = pos + simd::find_substring(str.data() + pos, str.size() - pos, from.data(), from.size());
+                if (found == str.size()) break;
+                f(found);
+                pos = found + from.size();
+            }
+        }
+
+        /**
+         * Calls f(index, pattern) at every position where one of the patterns starts, left to right and non overlapping
+         * When several patterns match at the same position the first one listed wins, empty patterns are ignored
+         */
+        inline void for_each_occurrence(const std::string_view str, const std::span<const std::pair<std::string_view, std::string_view>> patterns, auto&& f) {
+            bool starts[256] = {};
+            for (const auto& [from, _] : patterns) {
+                if (!from.empty()) starts[static_cast<unsigned char>(from[0])] = true;
+            }
+
+            size_t pos = 0;
+            while (pos < str.size()) {
+                if (!starts[static_cast<unsigned char>(str[pos])]) {
+                    ++pos;
+                    continue;
+                }
+
+                const auto rest = str.substr(pos);
+                const auto match = std::find_if(patterns.begin(), patterns.end(), [&](const auto& pattern) {
+                    return !pattern.first.empty() && rest.starts_with(pattern.first);
+                });
+                if (match == patterns.end()) {
+                    ++pos;
+                    continue;
+                }
+
+                f(pos, *match);
+                pos += match->first.size();
+            }
+        }
+
+        [[nodiscard]] inline size_t count_occurrences(const std::string_view str, const std::string_view from) {
+            size_t matches = 0;
+            for_each_occurrence(str, from, [&](size_t) { ++matches; });
+            return matches;
+        }
+
+        /**
+         * dest must hold exactly the replaced size
+         */
+        inline void write_replaced(const std::string_view str, const std::string_view from, const std::string_view to, char* dest) {
+            size_t copied = 0;
+            for_each_occurrence(str, from, [&](const size_t pos) {
+                std::memcpy(dest, str.data() + copied, pos - copied);
+                dest += pos - copied;
+                std::memcpy(dest, to.data(), to.size());
+                dest += to.size();
+                copied = pos + from.size();
+            });
+            std::memcpy(dest, str.data() + copied, str.size() - copied);
+        }
+    }
+
+    /**
+     * Finds every match first so the result is built in a single pass, an empty from leaves str unchanged
+     */
     [[nodiscard]] inline constexpr std::string replace_all(const std::string_view str, const std::string_view from, const std::string_view to) {
-        std::string ret{str};
-        replace_all_inplace(ret, from, to);
+        if (from.empty()) return std::string{str};
+
+        if (std::is_constant_evaluated()) {
+            std::string ret{str};
+            size_t start_pos = 0;
+            while ((start_pos = ret.find(from, start_pos)) != std::string::npos) {
+                ret.replace(start_pos, from.length(), to);
+                start_pos += to.length();
+            }
+            return ret;
+        }
+
+        const auto matches = internal::count_occurrences(str, from);
+        if (matches == 0) return std::string{str};
+
+        std::string ret(str.size() - matches * from.size() + matches * to.size(), '\0');
+        internal::write_replaced(str, from, to, ret.data());
         return ret;
     }
 
-    template <types::UnsignedInteger N>
+    /**
+     * Same as replace_all but the result lives in the arena, str is returned as is when nothing matches
+     */
+    [[nodiscard]] inline std::string_view replace_all(arena& arena, const std::string_view str, const std::string_view from, const std::string_view to) {
+        if (from.empty()) return str;
+
+        const auto matches = internal::count_occurrences(str, from);
+        if (matches == 0) return str;
+
+        const auto size = str.size() - matches * from.size() + matches * to.size();
+        char* dest = arena.allocate(size);
+        internal::write_replaced(str, from, to, dest);
+        return {dest, size};
+    }
+
+    /**
+     * Linear in the size of str, when to is not longer than from the string is compacted in place without allocating
+     */
+    inline constexpr void replace_all_inplace(std::string& str, const std::string_view from, const std::string_view to) {
+        if (from.empty()) return;
+
+        if (std::is_constant_evaluated() || to.size() > from.size()) {
+            str = replace_all(str, from, to);
+            return;
+        }
+
+        // the write position never passes the read position, so the part still to be searched is untouched
+        char* data = str.data();
+        size_t write = 0;
+        size_t read = 0;
+        internal::for_each_occurrence(str, from, [&](const size_t pos) {
+            std::memmove(data + write, data + read, pos - read);
+            write += pos - read;
+            std::memcpy(data + write, to.data(), to.size());
+            write += to.size();
+            read = pos + from.size();
+        });
+        std::memmove(data + write, data + read, str.size() - read);
+        str.resize(write + str.size() - read);
+    }
+
+    /**
+     * Replaces every {from, to} pair in one scan of str, see internal::for_each_occurrence for how overlapping patterns resolve
+     * Replaced text is never searched again, so the order of the pairs only matters for patterns starting at the same position
+     */
+    [[nodiscard]] inline std::string replace_all(const std::string_view str, const std::span<const std::pair<std::string_view, std::string_view>> replacements) {
+        size_t size = str.size();
+        internal::for_each_occurrence(str, replacements, [&](size_t, const auto& replacement) {
+            size = size - replacement.first.size() + replacement.second.size();
+        });
+
+        std::string ret(size, '\0');
+        char* dest = ret.data();
+        size_t copied = 0;
+        internal::for_each_occurrence(str, replacements, [&](const size_t pos, const auto& replacement) {
+            std::memcpy(dest, str.data() + copied, pos - copied);
+            dest += pos - copied;
+            std::memcpy(dest, replacement.second.data(), replacement.second.size());
+            dest += replacement.second.size();
+            copied = pos + replacement.first.size();
+        });
+        std::memcpy(dest, str.data() + copied, str.size() - copied);
+        return ret;
+    }
+
+    [[nodiscard]] inline std::string replace_all(const std::string_view str, const std::initializer_list<std::pair<std::string_view, std::string_view>> replacements) {
+        return replace_all(str, std::span{replacements.begin(), replacements.size()});
+    }
+
+    namespace internal {
+        /**
+         * Longest output std::to_chars can produce for T, integers in base 2 with a sign or floats in shortest form
+         */
+        template <types::Number T>
+        inline constexpr size_t max_chars = types::Integer<T>
+            ? std::numeric_limits<T>::digits + 2
+            : std::numeric_limits<T>::max_digits10 + 10;
+
+        [[nodiscard]] inline constexpr bool is_space(const char c) noexcept {
+            return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+        }
+
+        [[nodiscard]] inline constexpr std::string_view trim(std::string_view str) noexcept {
+            while (!str.empty() && is_space(str.front())) str.remove_prefix(1);
+            while (!str.empty() && is_space(str.back())) str.remove_suffix(1);
+            return str;
+        }
+    }
+
+    /**
+     * Parses the leading number in str, trailing characters are ignored
+     * Floats accept both fixed and scientific notation
+     */
+    template <types::Number N>
     [[nodiscard]] inline constexpr std::optional<N> to_number(const std::string_view str) noexcept {
         N num;
         if (std::from_chars(str.data(), str.data() + str.size(), num).ec == std::errc()) return num;
@@ -94,19 +669,169 @@ namespace usylibpp::strings {
     }
 
     /**
-     * String view only survives to next function call on this thread, make copy into std::string to keep alive
+     * Integers in any base from 2 to 36, without a 0x / 0 prefix
      */
-    template <types::UnsignedInteger T>
-    [[nodiscard]] inline std::optional<std::string_view> to_string_view(T val) noexcept {
-        constexpr auto TO_STRING_BUFFER_LENGTH = 21;
+    template <types::Integer N>
+    [[nodiscard]] inline constexpr std::optional<N> to_number(const std::string_view str, const int base) noexcept {
+        N num;
+        if (std::from_chars(str.data(), str.data() + str.size(), num, base).ec == std::errc()) return num;
+        return std::nullopt;
+    }
+
+    /**
+     * Stricter and more forgiving than to_number at once: surrounding whitespace and a leading '+' are accepted,
+     * but the rest of str has to be exactly one number
+     * Integers take any base from 2 to 36, floats only 10 or 16 (hex floats like 1.8p3, without a 0x prefix), any other base gives std::nullopt
+     */
+    template <types::Number N>
+    [[nodiscard]] inline constexpr std::optional<N> parse_number(std::string_view str, const int base = 10) noexcept {
+        str = internal::trim(str);
+        if (str.size() > 1 && str.front() == '+' && str[1] != '-') str.remove_prefix(1);
 
-        static thread_local char buffer[TO_STRING_BUFFER_LENGTH];
-        auto [ptr, ec] = std::to_chars(buffer, buffer + TO_STRING_BUFFER_LENGTH, val);
+        N num;
+        std::from_chars_result result;
+        if constexpr (types::Integer<N>) {
+            result = std::from_chars(str.data(), str.data() + str.size(), num, base);
+        } else {
+            if (base != 10 && base != 16) return std::nullopt;
+            result = std::from_chars(str.data(), str.data() + str.size(), num, base == 16 ? std::chars_format::hex : std::chars_format::general);
+        }
+        if (result.ec != std::errc() || result.ptr != str.data() + str.size()) return std::nullopt;
+        return num;
+    }
+
+    /**
+     * Writes val into out, returns the written part or std::nullopt if it does not fit
+     * Floats use the shortest form that parses back to the same value
+     */
+    template <types::Number T>
+    [[nodiscard]] inline std::optional<std::string_view> to_chars_into(const std::span<char> out, const T val) noexcept {
+        auto [ptr, ec] = std::to_chars(out.data(), out.data() + out.size(), val);
         if (ec != std::errc()) return std::nullopt;
-        return std::string_view{buffer, static_cast<size_t>(ptr - buffer)};
+        return std::string_view{out.data(), static_cast<size_t>(ptr - out.data())};
+    }
+
+    template <types::Integer T>
+    [[nodiscard]] inline std::optional<std::string_view> to_chars_into(const std::span<char> out, const T val, const int base) noexcept {
+        auto [ptr, ec] = std::to_chars(out.data(), out.data() + out.size(), val, base);
+        if (ec != std::errc()) return std::nullopt;
+        return std::string_view{out.data(), static_cast<size_t>(ptr - out.data())};
+    }
+
+    /**
+     * Fixed capacity string stored inline, returned by value so it lives as long as the caller keeps it
+     */
+    template <size_t N, typename Char = char>
+    class small_string {
+    private:
+        Char buffer[N + 1]{};
+        size_t length = 0;
+    public:
+        constexpr small_string() noexcept = default;
+
+        /**
+         * Anything past capacity is cut off
+         */
+        constexpr small_string(const std::basic_string_view<Char> str) noexcept {
+            resize(str.size());
+            std::copy_n(str.data(), length, buffer);
+        }
+
+        [[nodiscard]] static constexpr size_t capacity() noexcept {
+            return N;
+        }
+
+        /**
+         * Clamped to capacity, new characters are left as whatever was there before
+         */
+        constexpr void resize(const size_t size) noexcept {
+            length = size < N ? size : N;
+            buffer[length] = Char{};
+        }
+
+        [[nodiscard]] constexpr size_t size() const noexcept {
+            return length;
+        }
+
+        [[nodiscard]] constexpr bool empty() const noexcept {
+            return length == 0;
+        }
+
+        [[nodiscard]] constexpr Char* data() noexcept {
+            return buffer;
+        }
+
+        [[nodiscard]] constexpr const Char* data() const noexcept {
+            return buffer;
+        }
+
+        [[nodiscard]] constexpr const Char* c_str() const noexcept {
+            return buffer;
+        }
+
+        [[nodiscard]] constexpr std::basic_string_view<Char> view() const noexcept {
+            return {buffer, length};
+        }
+
+        constexpr operator std::basic_string_view<Char>() const noexcept {
+            return view();
+        }
+
+        [[nodiscard]] constexpr bool operator==(const small_string& other) const noexcept {
+            return view() == other.view();
+        }
+    };
+
+    /**
+     * Always fits, max_chars covers every value in every base
+     */
+    template <types::Number T>
+    [[nodiscard]] inline small_string<internal::max_chars<T>> to_small_string(const T val) noexcept {
+        small_string<internal::max_chars<T>> result;
+        const auto ptr = std::to_chars(result.data(), result.data() + result.capacity(), val).ptr;
+        result.resize(static_cast<size_t>(ptr - result.data()));
+        return result;
+    }
+
+    template <types::Integer T>
+    [[nodiscard]] inline small_string<internal::max_chars<T>> to_small_string(const T val, const int base) noexcept {
+        small_string<internal::max_chars<T>> result;
+        const auto ptr = std::to_chars(result.data(), result.data() + result.capacity(), val, base).ptr;
+        result.resize(static_cast<size_t>(ptr - result.data()));
+        return result;
+    }
+
+    /**
+     * The view lives in a per thread ring and survives the next view_slots - 1 calls on this thread,
+     * use to_small_string to keep the value around for longer
+     */
+    template <types::Number T>
+    [[nodiscard]] inline std::optional<std::string_view> to_string_view(T val) noexcept {
+        auto& slot = internal::next_slot<std::array<char, internal::max_chars<T>>>();
+        return to_chars_into(slot, val);
+    }
+
+    /**
+     * See to_string_view(T)
+     */
+    template <types::Integer T>
+    [[nodiscard]] inline std::optional<std::string_view> to_string_view(T val, const int base) noexcept {
+        auto& slot = internal::next_slot<std::array<char, internal::max_chars<T>>>();
+        return to_chars_into(slot, val, base);
     }
 
     inline constexpr void split_by_for_each(const std::string_view input, const unsigned char split_by, const auto& f) noexcept {
+        if (!std::is_constant_evaluated()) {
+            // one vector compare yields every delimiter in the block, instead of a find call per field
+            size_t start = 0;
+            simd::for_each_match(input.data(), input.size(), static_cast<char>(split_by), [&](const size_t end) {
+                f(input.substr(start, end - start));
+                start = end + 1;
+            });
+            if (start < input.size()) f(input.substr(start));
+            return;
+        }
+
         size_t start = 0;
         const auto size = input.size();
         while (start < size) {
@@ -125,12 +850,212 @@ namespace usylibpp::strings {
         split_by_for_each(input, '\n', f);
     }
 
+    /**
+     * for_each_line split across the default parallel pool in at most thread_count (0 for std::thread::hardware_concurrency) newline aligned chunks
+     * f is called concurrently so it has to be thread safe, lines are only in order within a chunk
+     * Small inputs run on the calling thread
+     */
+    inline void parallel_for_each_line(const std::string_view input, const auto& f, const size_t thread_count = 0) {
+        parallel::for_each_chunk(input, '\n', [&](const std::string_view chunk) { for_each_line(chunk, f); }, thread_count);
+    }
+
+    /**
+     * Map-reduce over the lines of input, every chunk is folded into a local copy of init with map(T& acc, std::string_view line)
+     * The accumulators are then merged in input order with reduce(T& total, T&& acc), so init should be the identity value
+     * Any copyable T works, bool included, since accumulators never live in a shared std::vector<T>
+     */
+    template <typename T>
+    [[nodiscard]] inline T parallel_reduce_lines(const std::string_view input, const T& init, const auto& map, const auto& reduce, const size_t thread_count = 0) {
+        return parallel::reduce_chunks(input, '\n', init, [&](T& acc, const std::string_view chunk) {
+            for_each_line(chunk, [&](const std::string_view line) { map(acc, line); });
+        }, reduce, thread_count);
+    }
+
     [[nodiscard]] inline constexpr size_t count_of(const std::string_view str, const char c) noexcept {
+        if (!std::is_constant_evaluated()) return simd::count(str.data(), str.size(), c);
+
         size_t count = 0;
         for (const auto a : str) if (a == c) ++count;
         return count;
     }
 
+    /**
+     * Parses a whole delimited column of numbers with parse_number, fields are found with the vectorised split_by_for_each
+     * The output is sized up front from the delimiter count, returns std::nullopt if any field is not a number
+     */
+    template <types::Number T>
+    [[nodiscard]] inline std::optional<std::vector<T>> parse_column(const std::string_view input, const char delimiter = ',', const int base = 10) {
+        std::vector<T> out;
+        out.reserve(count_of(input, delimiter) + 1);
+
+        bool ok = true;
+        split_by_for_each(input, delimiter, [&](const std::string_view field) {
+            if (!ok) return;
+            const auto num = parse_number<T>(field, base);
+            if (num) out.push_back(*num);
+            else ok = false;
+        });
+
+        if (!ok) return std::nullopt;
+        return out;
+    }
+
+    /**
+     * Same as parse_column but writes into out, returns the number of values written
+     * std::nullopt if a field is not a number or there are more fields than out can hold
+     */
+    template <types::Number T>
+    [[nodiscard]] inline std::optional<size_t> parse_column_into(const std::string_view input, const std::span<T> out, const char delimiter = ',', const int base = 10) {
+        size_t count = 0;
+        bool ok = true;
+        split_by_for_each(input, delimiter, [&](const std::string_view field) {
+            if (!ok) return;
+            const auto num = count < out.size() ? parse_number<T>(field, base) : std::nullopt;
+            if (num) out[count++] = *num;
+            else ok = false;
+        });
+
+        if (!ok) return std::nullopt;
+        return count;
+    }
+
+    /**
+     * Fills fields with every field of input, reusing its capacity so steady state rows do not allocate
+     * Unlike split_by_for_each empty fields are kept, a trailing one included, so field indices stay stable
+     * An empty input has no fields
+     */
+    inline void split_into(const std::string_view input, const char delimiter, std::vector<std::string_view>& fields) {
+        fields.clear();
+        if (input.empty()) return;
+
+        size_t start = 0;
+        simd::for_each_match(input.data(), input.size(), delimiter, [&](const size_t end) {
+            fields.push_back(input.substr(start, end - start));
+            start = end + 1;
+        });
+        fields.push_back(input.substr(start));
+    }
+
+    /**
+     * Multi character delimiter, see split_into above, an empty delimiter yields input as the only field
+     */
+    inline void split_into(const std::string_view input, const std::string_view delimiter, std::vector<std::string_view>& fields) {
+        fields.clear();
+        if (input.empty()) return;
+        if (delimiter.empty()) {
+            fields.push_back(input);
+            return;
+        }
+
+        size_t start = 0;
+        internal::for_each_occurrence(input, delimiter, [&](const size_t end) {
+            fields.push_back(input.substr(start, end - start));
+            start = end + delimiter.size();
+        });
+        fields.push_back(input.substr(start));
+    }
+
+    /**
+     * Quote aware RFC 4180 style split of one record, delimiters inside double quoted fields do not split
+     * The surrounding quotes are stripped, but since the views point into input an escaped quote ("") stays doubled,
+     * run replace_all(field, "\"\"", "\"") on the fields that need it
+     * Returns false on an unterminated quote or text between a closing quote and the next delimiter
+     */
+    [[nodiscard]] inline bool split_csv_into(const std::string_view input, const char delimiter, std::vector<std::string_view>& fields) {
+        fields.clear();
+        if (input.empty()) return true;
+
+        size_t pos = 0;
+        while (true) {
+            if (pos < input.size() && input[pos] == '"') {
+                size_t close = pos + 1;
+                while (true) {
+                    close += simd::find(input.data() + close, input.size() - close, '"');
+                    if (close >= input.size()) return false;
+                    if (close + 1 < input.size() && input[close + 1] == '"') {
+                        close += 2;
+                        continue;
+                    }
+                    break;
+                }
+
+                fields.push_back(input.substr(pos + 1, close - pos - 1));
+                pos = close + 1;
+                if (pos == input.size()) return true;
+                if (input[pos] != delimiter) return false;
+                ++pos;
+                continue;
+            }
+
+            const auto end = pos + simd::find(input.data() + pos, input.size() - pos, delimiter);
+            fields.push_back(input.substr(pos, end - pos));
+            if (end == input.size()) return true;
+            pos = end + 1;
+        }
+    }
+
+    /**
+     * Owns a reusable field vector for splitting many rows, with direct access to field N of the current row
+     * Fields point into the last input and are replaced by the next split
+     */
+    class tokenizer {
+    private:
+        std::vector<std::string_view> fields;
+    public:
+        tokenizer() = default;
+
+        explicit tokenizer(const size_t expected_fields) {
+            fields.reserve(expected_fields);
+        }
+
+        const std::vector<std::string_view>& split(const std::string_view input, const char delimiter) {
+            split_into(input, delimiter, fields);
+            return fields;
+        }
+
+        const std::vector<std::string_view>& split(const std::string_view input, const std::string_view delimiter) {
+            split_into(input, delimiter, fields);
+            return fields;
+        }
+
+        /**
+         * See split_csv_into, the fields are left empty when the record is malformed
+         */
+        [[nodiscard]] bool split_csv(const std::string_view input, const char delimiter = ',') {
+            if (split_csv_into(input, delimiter, fields)) return true;
+            fields.clear();
+            return false;
+        }
+
+        [[nodiscard]] std::string_view operator[](const size_t index) const noexcept {
+            return fields[index];
+        }
+
+        /**
+         * std::nullopt past the last field
+         */
+        [[nodiscard]] std::optional<std::string_view> at(const size_t index) const noexcept {
+            if (index >= fields.size()) return std::nullopt;
+            return fields[index];
+        }
+
+        [[nodiscard]] size_t size() const noexcept {
+            return fields.size();
+        }
+
+        [[nodiscard]] bool empty() const noexcept {
+            return fields.empty();
+        }
+
+        [[nodiscard]] auto begin() const noexcept {
+            return fields.begin();
+        }
+
+        [[nodiscard]] auto end() const noexcept {
+            return fields.end();
+        }
+    };
+
     /**
      * Includes the null terminator
      */
@@ -139,25 +1064,744 @@ namespace usylibpp::strings {
         return N;
     }
 
-    [[nodiscard]] inline std::string url_encode(std::string_view url) {
-        static constexpr char hex[] = "0123456789ABCDEF";
+    namespace internal {
+        /**
+         * Unreserved characters from RFC 3986, everything else gets percent encoded
+         */
+        inline constexpr auto url_unreserved = [] {
+            std::array<uint8_t, 256> table{};
+            for (unsigned char c = 'A'; c <= 'Z'; ++c) table[c] = 1;
+            for (unsigned char c = 'a'; c <= 'z'; ++c) table[c] = 1;
+            for (unsigned char c = '0'; c <= '9'; ++c) table[c] = 1;
+            for (const unsigned char c : {'-', '_', '.', '~'}) table[c] = 1;
+            return table;
+        }();
 
+        /**
+         * -1 for anything that is not a hex digit
+         */
+        inline constexpr auto hex_values = [] {
+            std::array<int8_t, 256> table{};
+            table.fill(-1);
+            for (int c = 0; c < 10; ++c) table['0' + c] = static_cast<int8_t>(c);
+            for (int c = 0; c < 6; ++c) table['a' + c] = table['A' + c] = static_cast<int8_t>(10 + c);
+            return table;
+        }();
+    }
+
+    namespace internal {
+        [[nodiscard]] inline size_t url_encoded_size(const std::string_view url) noexcept {
+            // branch free so the counting loop vectorises
+            size_t safe = 0;
+            for (const unsigned char c : url) safe += url_unreserved[c];
+            return safe + (url.size() - safe) * 3;
+        }
+
+        /**
+         * dest must hold url_encoded_size(url) bytes
+         */
+        inline void write_url_encoded(const std::string_view url, char* dest, const size_t encoded_size) noexcept {
+            static constexpr char hex[] = "0123456789ABCDEF";
+
+            if (encoded_size == url.size()) {
+                std::memcpy(dest, url.data(), url.size());
+                return;
+            }
+
+            size_t i = 0;
+            while (i < url.size()) {
+                const auto run_start = i;
+                while (i < url.size() && url_unreserved[static_cast<unsigned char>(url[i])]) ++i;
+                std::memcpy(dest, url.data() + run_start, i - run_start);
+                dest += i - run_start;
+
+                for (; i < url.size() && !url_unreserved[static_cast<unsigned char>(url[i])]; ++i) {
+                    const auto c = static_cast<unsigned char>(url[i]);
+                    dest[0] = '%';
+                    dest[1] = hex[c >> 4];
+                    dest[2] = hex[c & 0xF];
+                    dest += 3;
+                }
+            }
+        }
+    }
+
+    /**
+     * Appends the percent encoding of url to out, growing it exactly once
+     */
+    inline void url_encode_into(const std::string_view url, std::string& out) {
+        const auto size = internal::url_encoded_size(url);
+        const auto offset = out.size();
+        out.resize(offset + size);
+        internal::write_url_encoded(url, out.data() + offset, size);
+    }
+
+    [[nodiscard]] inline std::string url_encode(const std::string_view url) {
         std::string out;
-        out.reserve(url.size() * 3); // worst case
-
-        for (unsigned char c : url) {
-            if ((c >= 'A' && c <= 'Z') ||
-                (c >= 'a' && c <= 'z') ||
-                (c >= '0' && c <= '9') ||
-                c == '-' || c == '_' || c == '.' || c == '~') {
-                out.push_back(c);
-            } else {
-                out.push_back('%');
-                out.push_back(hex[c >> 4]);
-                out.push_back(hex[c & 0xF]);
+        url_encode_into(url, out);
+        return out;
+    }
+
+    /**
+     * Same as url_encode but the result lives in the arena
+     */
+    [[nodiscard]] inline std::string_view url_encode(arena& arena, const std::string_view url) {
+        const auto size = internal::url_encoded_size(url);
+        char* dest = arena.allocate(size);
+        internal::write_url_encoded(url, dest, size);
+        return {dest, size};
+    }
+
+    /**
+     * Appends the decoding of every %XX escape in url to out, '+' is left as is
+     * Returns false and leaves out unchanged on a truncated or non hex escape
+     */
+    [[nodiscard]] inline bool url_decode_into(const std::string_view url, std::string& out) {
+        // sized for the worst case, counting escapes up front is wrong as soon as one of them turns out to be malformed
+        const auto offset = out.size();
+        out.resize(offset + url.size());
+        char* dest = out.data() + offset;
+
+        size_t i = 0;
+        while (i < url.size()) {
+            const auto next = i + simd::find(url.data() + i, url.size() - i, '%');
+            std::memcpy(dest, url.data() + i, next - i);
+            dest += next - i;
+            if (next == url.size()) break;
+
+            if (next + 2 >= url.size()) {
+                out.resize(offset);
+                return false;
             }
+            const auto high = internal::hex_values[static_cast<unsigned char>(url[next + 1])];
+            const auto low = internal::hex_values[static_cast<unsigned char>(url[next + 2])];
+            if ((high | low) < 0) {
+                out.resize(offset);
+                return false;
+            }
+
+            *dest++ = static_cast<char>((high << 4) | low);
+            i = next + 3;
         }
+        out.resize(static_cast<size_t>(dest - out.data()));
+        return true;
+    }
 
+    /**
+     * Returns std::nullopt on a truncated or non hex escape
+     */
+    [[nodiscard]] inline std::optional<std::string> url_decode(const std::string_view url) {
+        std::string out;
+        if (!url_decode_into(url, out)) return std::nullopt;
         return out;
     }
+
+    namespace internal {
+        inline constexpr uint64_t hash_secret[4] = {0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull, 0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull};
+
+        /**
+         * Full 64x64 -> 128 bit product, returns the low half in a and the high half in b
+         */
+        inline constexpr void multiply_128(uint64_t& a, uint64_t& b) noexcept {
+            if (!std::is_constant_evaluated()) {
+                #if defined(__SIZEOF_INT128__)
+                const auto product = static_cast<unsigned __int128>(a) * b;
+                a = static_cast<uint64_t>(product);
+                b = static_cast<uint64_t>(product >> 64);
+                return;
+                #elif defined(_MSC_VER) && defined(_M_X64)
+                a = _umul128(a, b, &b);
+                return;
+                #endif
+            }
+
+            const uint64_t ha = a >> 32, la = static_cast<uint32_t>(a), hb = b >> 32, lb = static_cast<uint32_t>(b);
+            const uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+            const uint64_t t = rl + (rm0 << 32);
+            uint64_t carry = t < rl;
+            const uint64_t lo = t + (rm1 << 32);
+            carry += lo < t;
+            a = lo;
+            b = rh + (rm0 >> 32) + (rm1 >> 32) + carry;
+        }
+
+        [[nodiscard]] inline constexpr uint64_t hash_mix(uint64_t a, uint64_t b) noexcept {
+            multiply_128(a, b);
+            return a ^ b;
+        }
+
+        [[nodiscard]] inline constexpr uint64_t read_64(const char* p) noexcept {
+            if (!std::is_constant_evaluated() && std::endian::native == std::endian::little) {
+                uint64_t v;
+                std::memcpy(&v, p, sizeof(v));
+                return v;
+            }
+            uint64_t v = 0;
+            for (size_t i = 0; i < 8; ++i) v |= static_cast<uint64_t>(static_cast<unsigned char>(p[i])) << (8 * i);
+            return v;
+        }
+
+        [[nodiscard]] inline constexpr uint64_t read_32(const char* p) noexcept {
+            if (!std::is_constant_evaluated() && std::endian::native == std::endian::little) {
+                uint32_t v;
+                std::memcpy(&v, p, sizeof(v));
+                return v;
+            }
+            uint64_t v = 0;
+            for (size_t i = 0; i < 4; ++i) v |= static_cast<uint64_t>(static_cast<unsigned char>(p[i])) << (8 * i);
+            return v;
+        }
+    }
+
+    /**
+     * 64 bit non cryptographic hash, the wyhash (final version 4) algorithm, fine for hash tables but not for untrusted keys
+     * Long inputs are consumed 48 bytes at a time over three independent multiply chains, so it runs at several GB/s
+     * Usable at compile time, the result does not depend on the platform
+     */
+    [[nodiscard]] inline constexpr uint64_t hash(const std::string_view str, uint64_t seed = 0) noexcept {
+        using internal::hash_secret;
+        using internal::hash_mix;
+        using internal::read_32;
+        using internal::read_64;
+
+        const char* p = str.data();
+        const size_t size = str.size();
+        seed ^= hash_mix(seed ^ hash_secret[0], hash_secret[1]);
+
+        uint64_t a = 0;
+        uint64_t b = 0;
+        if (size <= 16) {
+            if (size >= 4) {
+                const auto step = (size >> 3) << 2;
+                a = (read_32(p) << 32) | read_32(p + step);
+                b = (read_32(p + size - 4) << 32) | read_32(p + size - 4 - step);
+            } else if (size > 0) {
+                a = (static_cast<uint64_t>(static_cast<unsigned char>(p[0])) << 16)
+                  | (static_cast<uint64_t>(static_cast<unsigned char>(p[size >> 1])) << 8)
+                  | static_cast<uint64_t>(static_cast<unsigned char>(p[size - 1]));
+            }
+        } else {
+            size_t i = size;
+            if (i > 48) {
+                uint64_t lane1 = seed;
+                uint64_t lane2 = seed;
+                do {
+                    seed = hash_mix(read_64(p) ^ hash_secret[1], read_64(p + 8) ^ seed);
+                    lane1 = hash_mix(read_64(p + 16) ^ hash_secret[2], read_64(p + 24) ^ lane1);
+                    lane2 = hash_mix(read_64(p + 32) ^ hash_secret[3], read_64(p + 40) ^ lane2);
+                    p += 48;
+                    i -= 48;
+                } while (i > 48);
+                seed ^= lane1 ^ lane2;
+            }
+            while (i > 16) {
+                seed = hash_mix(read_64(p) ^ hash_secret[1], read_64(p + 8) ^ seed);
+                i -= 16;
+                p += 16;
+            }
+            a = read_64(p + i - 16);
+            b = read_64(p + i - 8);
+        }
+
+        a ^= hash_secret[1];
+        b ^= seed;
+        internal::multiply_128(a, b);
+        return hash_mix(a ^ hash_secret[0] ^ size, b ^ hash_secret[1]);
+    }
+
+    /**
+     * Transparent hasher, lets std::unordered_map<std::string, V, string_hash, std::equal_to<>> look up string_views without a temporary string
+     */
+    struct string_hash {
+        using is_transparent = void;
+
+        [[nodiscard]] size_t operator()(const std::string_view str) const noexcept {
+            return static_cast<size_t>(hash(str));
+        }
+    };
+
+    /**
+     * Open addressing hash map from strings to V, lookups take a string_view and never allocate
+     * Entries live contiguously in insertion order (until an erase moves the last one into the gap), the table itself only holds
+     * one control byte and one 32 bit index per slot, control bytes carry 7 bits of the hash and are matched 16 at a time with SSE2
+     * Key can be std::string_view when the text outlives the map, such as strings kept in an arena
+     * Keys must not be changed through iterators, inserting or erasing invalidates pointers and iterators
+     */
+    template <typename V, typename Key = std::string>
+    class flat_map {
+    public:
+        using value_type = std::pair<Key, V>;
+        using iterator = typename std::vector<value_type>::iterator;
+        using const_iterator = typename std::vector<value_type>::const_iterator;
+    private:
+        static constexpr size_t group_width = 16;
+        static constexpr char empty_slot = static_cast<char>(0x80);
+        static constexpr char deleted_slot = static_cast<char>(0xFE);
+
+        std::vector<value_type> entries;
+        /**
+         * capacity control bytes followed by a copy of the first group_width - 1, so a group can be loaded at any slot
+         */
+        std::unique_ptr<char[]> control;
+        std::unique_ptr<uint32_t[]> slots;
+        size_t capacity = 0;
+        size_t growth_left = 0;
+
+        [[nodiscard]] static constexpr char fingerprint(const uint64_t h) noexcept {
+            return static_cast<char>(h & 0x7F);
+        }
+
+        [[nodiscard]] static constexpr size_t max_load(const size_t cap) noexcept {
+            return cap - cap / 8;
+        }
+
+        void set_control(const size_t slot, const char value) noexcept {
+            control[slot] = value;
+            if (slot < group_width - 1) control[capacity + slot] = value;
+        }
+
+        /**
+         * Visits the groups of the probe sequence for h until f returns true
+         */
+        template <typename F>
+        void probe(const uint64_t h, const F& f) const {
+            const size_t mask = capacity - 1;
+            size_t pos = static_cast<size_t>(h >> 7) & mask;
+            for (size_t step = group_width; !f(pos, mask); step += group_width) pos = (pos + step) & mask;
+        }
+
+        /**
+         * Slot holding key, or capacity if it is not there
+         */
+        [[nodiscard]] size_t find_slot(const std::string_view key, const uint64_t h) const noexcept {
+            if (capacity == 0) return 0;
+            size_t found = capacity;
+            probe(h, [&](const size_t pos, const size_t mask) {
+                for (auto bits = simd::eq_mask16(control.get() + pos, fingerprint(h)); bits != 0; bits &= bits - 1) {
+                    const auto slot = (pos + static_cast<size_t>(std::countr_zero(bits))) & mask;
+                    if (entries[slots[slot]].first == key) {
+                        found = slot;
+                        return true;
+                    }
+                }
+                return simd::eq_mask16(control.get() + pos, empty_slot) != 0;
+            });
+            return found;
+        }
+
+        /**
+         * First empty or deleted slot on the probe sequence for h
+         */
+        [[nodiscard]] size_t free_slot(const uint64_t h) const noexcept {
+            size_t found = 0;
+            probe(h, [&](const size_t pos, const size_t mask) {
+                const auto bits = simd::high_bit_mask16(control.get() + pos);
+                if (bits == 0) return false;
+                found = (pos + static_cast<size_t>(std::countr_zero(bits))) & mask;
+                return true;
+            });
+            return found;
+        }
+
+        /**
+         * Both arrays are allocated before the old table is let go, everything after that cannot throw
+         * so a failed allocation leaves the map as it was
+         */
+        void rehash(const size_t new_capacity) {
+            auto new_control = std::make_unique_for_overwrite<char[]>(new_capacity + group_width - 1);
+            auto new_slots = std::make_unique_for_overwrite<uint32_t[]>(new_capacity);
+            control = std::move(new_control);
+            slots = std::move(new_slots);
+            capacity = new_capacity;
+            std::memset(control.get(), empty_slot, capacity + group_width - 1);
+
+            for (size_t i = 0; i < entries.size(); ++i) {
+                const auto h = hash(entries[i].first);
+                const auto slot = free_slot(h);
+                set_control(slot, fingerprint(h));
+                slots[slot] = static_cast<uint32_t>(i);
+            }
+            growth_left = max_load(capacity) - entries.size();
+        }
+
+        /**
+         * Makes room for one more entry, grows when the table is at least half live entries and otherwise just clears out deleted slots
+         */
+        void prepare_insert() {
+            if (growth_left > 0) return;
+            const auto live = entries.size();
+            rehash(capacity == 0 ? group_width : (live * 2 >= max_load(capacity) ? capacity * 2 : capacity));
+        }
+    public:
+        flat_map() = default;
+
+        flat_map(const flat_map& other) : entries(other.entries) {
+            if (other.capacity != 0) rehash(other.capacity);
+        }
+
+        flat_map& operator=(const flat_map& other) {
+            if (this != &other) {
+                // copied in full first so a throwing copy leaves this map untouched
+                flat_map copy{other};
+                *this = std::move(copy);
+            }
+            return *this;
+        }
+
+        flat_map(flat_map&& other) noexcept
+            : entries(std::move(other.entries)), control(std::move(other.control)), slots(std::move(other.slots)),
+              capacity(std::exchange(other.capacity, 0)), growth_left(std::exchange(other.growth_left, 0)) {
+            other.entries.clear();
+        }
+
+        flat_map& operator=(flat_map&& other) noexcept {
+            if (this != &other) {
+                entries = std::move(other.entries);
+                control = std::move(other.control);
+                slots = std::move(other.slots);
+                capacity = std::exchange(other.capacity, 0);
+                growth_left = std::exchange(other.growth_left, 0);
+                other.entries.clear();
+            }
+            return *this;
+        }
+
+        [[nodiscard]] size_t size() const noexcept {
+            return entries.size();
+        }
+
+        [[nodiscard]] bool empty() const noexcept {
+            return entries.empty();
+        }
+
+        /**
+         * Bytes held by the entries and the table, not counting memory the keys and values own themselves
+         */
+        [[nodiscard]] size_t memory_usage() const noexcept {
+            return entries.capacity() * sizeof(value_type) + (capacity == 0 ? 0 : capacity * (1 + sizeof(uint32_t)) + group_width - 1);
+        }
+
+        /**
+         * Sizes the table so n entries fit without rehashing
+         */
+        void reserve(const size_t n) {
+            entries.reserve(n);
+            size_t needed = group_width;
+            while (max_load(needed) < n) needed *= 2;
+            if (needed > capacity) rehash(needed);
+        }
+
+        /**
+         * Keeps the table allocation
+         */
+        void clear() noexcept {
+            entries.clear();
+            if (capacity == 0) return;
+            std::memset(control.get(), empty_slot, capacity + group_width - 1);
+            growth_left = max_load(capacity);
+        }
+
+        [[nodiscard]] V* find(const std::string_view key) noexcept {
+            const auto slot = find_slot(key, hash(key));
+            return slot == capacity ? nullptr : &entries[slots[slot]].second;
+        }
+
+        [[nodiscard]] const V* find(const std::string_view key) const noexcept {
+            const auto slot = find_slot(key, hash(key));
+            return slot == capacity ? nullptr : &entries[slots[slot]].second;
+        }
+
+        [[nodiscard]] bool contains(const std::string_view key) const noexcept {
+            return find(key) != nullptr;
+        }
+
+        /**
+         * Inserts V(args...) under key unless it is already there, the key is only copied (or moved from a std::string) on insert
+         * Returns the value and whether it was inserted
+         */
+        template <typename K, typename... Args>
+        requires std::convertible_to<const K&, std::string_view>
+        std::pair<V*, bool> try_emplace(K&& key, Args&&... args) {
+            const std::string_view view = key;
+            const auto h = hash(view);
+            if (const auto slot = find_slot(view, h); slot != capacity) return {&entries[slots[slot]].second, false};
+
+            prepare_insert();
+            entries.emplace_back(std::piecewise_construct, std::forward_as_tuple(std::forward<K>(key)), std::forward_as_tuple(std::forward<Args>(args)...));
+            const auto slot = free_slot(h);
+            if (control[slot] == empty_slot) --growth_left;
+            set_control(slot, fingerprint(h));
+            slots[slot] = static_cast<uint32_t>(entries.size() - 1);
+            return {&entries.back().second, true};
+        }
+
+        template <typename K, typename T>
+        requires std::convertible_to<const K&, std::string_view>
+        std::pair<V*, bool> insert_or_assign(K&& key, T&& value) {
+            auto result = try_emplace(std::forward<K>(key), std::forward<T>(value));
+            if (!result.second) *result.first = std::forward<T>(value);
+            return result;
+        }
+
+        /**
+         * Default constructs the value if key is missing
+         */
+        V& operator[](const std::string_view key) {
+            return *try_emplace(key).first;
+        }
+
+        /**
+         * Moves the last entry into the erased one's place, returns false if key was not there
+         */
+        bool erase(const std::string_view key) {
+            const auto slot = find_slot(key, hash(key));
+            if (slot == capacity) return false;
+
+            const auto index = slots[slot];
+            set_control(slot, deleted_slot);
+
+            const auto last = static_cast<uint32_t>(entries.size() - 1);
+            if (index != last) {
+                const auto moved = find_slot(entries[last].first, hash(entries[last].first));
+                slots[moved] = index;
+                entries[index] = std::move(entries[last]);
+            }
+            entries.pop_back();
+            return true;
+        }
+
+        [[nodiscard]] iterator begin() noexcept {
+            return entries.begin();
+        }
+
+        [[nodiscard]] iterator end() noexcept {
+            return entries.end();
+        }
+
+        [[nodiscard]] const_iterator begin() const noexcept {
+            return entries.begin();
+        }
+
+        [[nodiscard]] const_iterator end() const noexcept {
+            return entries.end();
+        }
+    };
+
+    /**
+     * Handle to a string in an intern_pool or concurrent_intern_pool, equal handles from the same pool mean equal strings
+     * so comparing and hashing is a single integer operation, ordering follows insertion and not the text
+     */
+    struct interned {
+        uint32_t id;
+
+        [[nodiscard]] friend constexpr bool operator==(const interned&, const interned&) noexcept = default;
+        [[nodiscard]] friend constexpr auto operator<=>(const interned&, const interned&) noexcept = default;
+    };
+
+    struct intern_stats {
+        /**
+         * Distinct strings stored
+         */
+        size_t strings = 0;
+        /**
+         * Calls to intern, hits are the ones that found the string already there
+         */
+        size_t lookups = 0;
+        size_t hits = 0;
+        /**
+         * Text passed to intern in total, against the text actually kept
+         */
+        size_t requested_bytes = 0;
+        size_t stored_bytes = 0;
+        /**
+         * Hash table and handle index on top of the text
+         */
+        size_t index_bytes = 0;
+    };
+
+    /**
+     * Deduplicates strings into an arena and hands out interned handles, each distinct string is stored once
+     * Views returned by view stay valid for the life of the pool, handles are dense indices starting at 0
+     * Not thread safe, see concurrent_intern_pool
+     */
+    class intern_pool {
+    private:
+        arena storage;
+        flat_map<uint32_t, std::string_view> ids;
+        std::vector<std::string_view> views;
+        size_t lookups = 0;
+        size_t hits = 0;
+        size_t requested_bytes = 0;
+    public:
+        explicit intern_pool(const size_t initial_size = arena::default_initial_size) : storage(initial_size) {}
+
+        intern_pool(const intern_pool&) = delete;
+        intern_pool& operator=(const intern_pool&) = delete;
+
+        /**
+         * Copies str into the pool the first time it is seen
+         */
+        [[nodiscard]] interned intern(const std::string_view str) {
+            ++lookups;
+            requested_bytes += str.size();
+            if (const auto* id = ids.find(str)) {
+                ++hits;
+                return {*id};
+            }
+
+            const auto id = static_cast<uint32_t>(views.size());
+            const auto stored = storage.copy(str);
+            views.push_back(stored);
+            (void) ids.try_emplace(stored, id);
+            return {id};
+        }
+
+        /**
+         * Looks str up without adding it
+         */
+        [[nodiscard]] std::optional<interned> find(const std::string_view str) const noexcept {
+            if (const auto* id = ids.find(str)) return interned{*id};
+            return std::nullopt;
+        }
+
+        [[nodiscard]] std::string_view view(const interned handle) const noexcept {
+            return views[handle.id];
+        }
+
+        [[nodiscard]] size_t size() const noexcept {
+            return views.size();
+        }
+
+        [[nodiscard]] intern_stats stats() const noexcept {
+            return {views.size(), lookups, hits, requested_bytes, storage.bytes_used(), ids.memory_usage() + views.capacity() * sizeof(std::string_view)};
+        }
+    };
+
+    /**
+     * intern_pool split into shards picked by the string hash, each behind its own reader writer lock
+     * Strings already in the pool only take a shared lock, so lookups of common strings do not serialise
+     * Handles keep the shard in their low bits, so a pool holds up to 2^32 / shards strings per shard
+     * Interning a new string into a full shard throws std::length_error instead of handing out a handle that wraps around
+     */
+    class concurrent_intern_pool {
+    private:
+        struct alignas(64) shard {
+            mutable std::shared_mutex mutex;
+            intern_pool pool;
+            std::atomic<size_t> lookups{0};
+            std::atomic<size_t> hits{0};
+            std::atomic<size_t> requested_bytes{0};
+        };
+
+        std::unique_ptr<shard[]> shards;
+        size_t shard_bits;
+        size_t shard_capacity;
+
+        [[nodiscard]] size_t shard_of(const std::string_view str) const noexcept {
+            // top bits of the hash, the low ones pick slots in the shard's own table
+            return shard_bits == 0 ? 0 : static_cast<size_t>(hash(str) >> (64 - shard_bits));
+        }
+    public:
+        /**
+         * shard_count is rounded up to a power of two and is at most 2^16
+         * max_per_shard lowers the number of strings a shard may hold below what fits in a handle, 0 for no extra limit
+         */
+        explicit concurrent_intern_pool(const size_t shard_count = 16, const size_t max_per_shard = 0)
+            : shard_bits(static_cast<size_t>(std::bit_width(std::clamp<size_t>(shard_count, 1, size_t{1} << 16) - 1))),
+              shard_capacity(size_t{1} << (32 - shard_bits)) {
+            if (max_per_shard != 0) shard_capacity = std::min(shard_capacity, max_per_shard);
+            shards = std::make_unique<shard[]>(size_t{1} << shard_bits);
+        }
+
+        /**
+         * Most distinct strings a single shard can take
+         */
+        [[nodiscard]] size_t max_per_shard() const noexcept {
+            return shard_capacity;
+        }
+
+        concurrent_intern_pool(const concurrent_intern_pool&) = delete;
+        concurrent_intern_pool& operator=(const concurrent_intern_pool&) = delete;
+
+        [[nodiscard]] interned intern(const std::string_view str) {
+            const auto index = shard_of(str);
+            auto& s = shards[index];
+            s.lookups.fetch_add(1, std::memory_order_relaxed);
+            s.requested_bytes.fetch_add(str.size(), std::memory_order_relaxed);
+
+            std::optional<interned> local;
+            {
+                std::shared_lock lock{s.mutex};
+                local = s.pool.find(str);
+            }
+            if (local) {
+                s.hits.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                std::lock_guard lock{s.mutex};
+                // another thread may have added it since the shared lock was dropped, that still fits
+                local = s.pool.find(str);
+                if (local) {
+                    s.hits.fetch_add(1, std::memory_order_relaxed);
+                } else {
+                    if (s.pool.size() >= shard_capacity) throw std::length_error("concurrent_intern_pool: shard is full");
+                    local = s.pool.intern(str);
+                }
+            }
+            return {static_cast<uint32_t>((local->id << shard_bits) | index)};
+        }
+
+        [[nodiscard]] std::optional<interned> find(const std::string_view str) const {
+            const auto index = shard_of(str);
+            auto& s = shards[index];
+            std::shared_lock lock{s.mutex};
+            const auto local = s.pool.find(str);
+            if (!local) return std::nullopt;
+            return interned{static_cast<uint32_t>((local->id << shard_bits) | index)};
+        }
+
+        [[nodiscard]] std::string_view view(const interned handle) const {
+            const auto& s = shards[handle.id & ((uint32_t{1} << shard_bits) - 1)];
+            std::shared_lock lock{s.mutex};
+            return s.pool.view({handle.id >> shard_bits});
+        }
+
+        [[nodiscard]] size_t size() const {
+            size_t total = 0;
+            for (size_t i = 0; i < (size_t{1} << shard_bits); ++i) {
+                std::shared_lock lock{shards[i].mutex};
+                total += shards[i].pool.size();
+            }
+            return total;
+        }
+
+        /**
+         * Sums the shards one at a time, so under concurrent use it is not a single point in time
+         */
+        [[nodiscard]] intern_stats stats() const {
+            intern_stats total;
+            for (size_t i = 0; i < (size_t{1} << shard_bits); ++i) {
+                const auto& s = shards[i];
+                intern_stats part;
+                {
+                    std::shared_lock lock{s.mutex};
+                    part = s.pool.stats();
+                }
+                total.strings += part.strings;
+                total.lookups += s.lookups.load(std::memory_order_relaxed);
+                total.hits += s.hits.load(std::memory_order_relaxed) + part.hits;
+                total.requested_bytes += s.requested_bytes.load(std::memory_order_relaxed);
+                total.stored_bytes += part.stored_bytes;
+                total.index_bytes += part.index_bytes;
+            }
+            total.index_bytes += (size_t{1} << shard_bits) * sizeof(shard);
+            return total;
+        }
+    };
 }
+
+template <>
+struct std::hash<usylibpp::strings::interned> {
+    [[nodiscard]] size_t operator()(const usylibpp::strings::interned handle) const noexcept {
+        return handle.id;
+    }
+};
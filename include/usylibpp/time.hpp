@@ -1,9 +1,33 @@
 #pragma once
 
 #include <string>
+#include <string_view>
+#include <span>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
 #include <ctime>
+#include <filesystem>
 #include <iomanip>
-#include <sstream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
 
 namespace usylibpp::time {
     /**
@@ -14,22 +38,743 @@ namespace usylibpp::time {
         #ifdef WIN32
         localtime_s(&cur_tm, &time);
         #else
-        localtime_r(&now_time, &cur_tm);
+        localtime_r(&time, &cur_tm);
         #endif
         return cur_tm;
     }
 
+    /**
+     * Length of "YYYY-MM-DD HH:MM:SS"
+     */
+    inline constexpr size_t datetime_length = 19;
+
+    /**
+     * Length of "YYYY-MM-DD HH:MM:SS.mmm"
+     */
+    inline constexpr size_t datetime_ms_length = 23;
+
+    /**
+     * Length of "YYYY-MM-DD HH:MM:SS.uuuuuu"
+     */
+    inline constexpr size_t datetime_us_length = 26;
+
+    /**
+     * Length of "YYYY-MM-DDTHH:MM:SS.uuuuuuZ"
+     */
+    inline constexpr size_t iso8601_length = 27;
+
+    namespace internal {
+        inline void write_digits(char* out, uint64_t value, size_t count) noexcept {
+            for (size_t i = count; i > 0; --i) {
+                out[i - 1] = static_cast<char>('0' + value % 10);
+                value /= 10;
+            }
+        }
+
+        /**
+         * Floors towards negative infinity so times before the epoch land in the right minute
+         */
+        [[nodiscard]] inline constexpr time_t minute_of(const time_t time) noexcept {
+            const auto rem = time % 60;
+            return time - (rem < 0 ? rem + 60 : rem);
+        }
+    }
+
+    /**
+     * Writes the local time as "YYYY-MM-DD HH:MM:SS" without allocating
+     * Everything up to the minute is cached per thread, so calls within the same minute only rewrite the two second digits
+     * This relies on the UTC offset being a whole number of minutes, which holds for every current time zone
+     */
+    inline void datetime_into(const std::span<char, datetime_length> out, const time_t time = std::time(nullptr)) {
+        static thread_local time_t cached_minute = std::numeric_limits<time_t>::min();
+        static thread_local char cached[datetime_length];
+
+        const auto minute = internal::minute_of(time);
+        if (minute != cached_minute) {
+            const auto tm = tm_safe(time);
+            internal::write_digits(cached, static_cast<uint64_t>(tm.tm_year + 1900), 4);
+            cached[4] = '-';
+            internal::write_digits(cached + 5, static_cast<uint64_t>(tm.tm_mon + 1), 2);
+            cached[7] = '-';
+            internal::write_digits(cached + 8, static_cast<uint64_t>(tm.tm_mday), 2);
+            cached[10] = ' ';
+            internal::write_digits(cached + 11, static_cast<uint64_t>(tm.tm_hour), 2);
+            cached[13] = ':';
+            internal::write_digits(cached + 14, static_cast<uint64_t>(tm.tm_min), 2);
+            cached[16] = ':';
+            cached_minute = minute;
+        }
+
+        std::memcpy(out.data(), cached, 17);
+        internal::write_digits(out.data() + 17, static_cast<uint64_t>(time - minute), 2);
+    }
+
+    /**
+     * Local time as "YYYY-MM-DD HH:MM:SS.mmm", see datetime_into
+     */
+    inline void datetime_ms_into(const std::span<char, datetime_ms_length> out, const std::chrono::system_clock::time_point now = std::chrono::system_clock::now()) {
+        const auto seconds = std::chrono::floor<std::chrono::seconds>(now);
+        datetime_into(out.first<datetime_length>(), std::chrono::system_clock::to_time_t(seconds));
+        out[datetime_length] = '.';
+        internal::write_digits(out.data() + datetime_length + 1, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(now - seconds).count()), 3);
+    }
+
+    /**
+     * Local time as "YYYY-MM-DD HH:MM:SS.uuuuuu", see datetime_into
+     */
+    inline void datetime_us_into(const std::span<char, datetime_us_length> out, const std::chrono::system_clock::time_point now = std::chrono::system_clock::now()) {
+        const auto seconds = std::chrono::floor<std::chrono::seconds>(now);
+        datetime_into(out.first<datetime_length>(), std::chrono::system_clock::to_time_t(seconds));
+        out[datetime_length] = '.';
+        internal::write_digits(out.data() + datetime_length + 1, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(now - seconds).count()), 6);
+    }
+
+    /**
+     * UTC as "YYYY-MM-DDTHH:MM:SS.uuuuuuZ", computed with the std::chrono calendar types instead of gmtime
+     */
+    inline void iso8601_into(const std::span<char, iso8601_length> out, const std::chrono::system_clock::time_point now = std::chrono::system_clock::now()) noexcept {
+        using namespace std::chrono;
+
+        const auto day = floor<days>(now);
+        const year_month_day ymd{day};
+        const hh_mm_ss hms{floor<microseconds>(now - day)};
+
+        char* p = out.data();
+        internal::write_digits(p, static_cast<uint64_t>(static_cast<int>(ymd.year())), 4);
+        p[4] = '-';
+        internal::write_digits(p + 5, static_cast<unsigned>(ymd.month()), 2);
+        p[7] = '-';
+        internal::write_digits(p + 8, static_cast<unsigned>(ymd.day()), 2);
+        p[10] = 'T';
+        internal::write_digits(p + 11, static_cast<uint64_t>(hms.hours().count()), 2);
+        p[13] = ':';
+        internal::write_digits(p + 14, static_cast<uint64_t>(hms.minutes().count()), 2);
+        p[16] = ':';
+        internal::write_digits(p + 17, static_cast<uint64_t>(hms.seconds().count()), 2);
+        p[19] = '.';
+        internal::write_digits(p + 20, static_cast<uint64_t>(hms.subseconds().count()), 6);
+        p[26] = 'Z';
+    }
+
     [[nodiscard]] inline auto datetime_stream(const tm& tm) {
         return std::put_time(&tm, "%Y-%m-%d %H:%M:%S");
     }
 
-    [[nodiscard]] inline auto datetime_stream(time_t time = std::time(nullptr)) {
-        return datetime_stream(tm_safe(time));
+    /**
+     * Holds its own copy of the text, so it can outlive the call unlike std::put_time on a temporary tm
+     */
+    struct datetime_text {
+        char text[datetime_length];
+
+        operator std::string_view() const noexcept {
+            return {text, datetime_length};
+        }
+
+        friend std::ostream& operator<<(std::ostream& stream, const datetime_text& datetime) {
+            return stream.write(datetime.text, datetime_length);
+        }
+    };
+
+    [[nodiscard]] inline datetime_text datetime_stream(time_t time = std::time(nullptr)) {
+        datetime_text result;
+        datetime_into(result.text, time);
+        return result;
     }
 
     [[nodiscard]] inline std::string datetime_string(time_t time = std::time(nullptr)) {
-        std::stringstream ss;
-        ss << datetime_stream(time);
-        return ss.str();
+        std::string result(datetime_length, '\0');
+        datetime_into(std::span<char, datetime_length>{result.data(), datetime_length}, time);
+        return result;
     }
-}
\ No newline at end of file
+
+    /**
+     * steady_clock in nanoseconds, the default clock for scoped_timer
+     */
+    struct steady_ticks {
+        [[nodiscard]] static uint64_t now() noexcept {
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+        }
+
+        [[nodiscard]] static uint64_t to_ns(const uint64_t ticks) noexcept {
+            return ticks;
+        }
+
+        /**
+         * A tick value as nanoseconds on the steady_clock timeline, trace events from both clocks share it
+         */
+        [[nodiscard]] static uint64_t to_steady_ns(const uint64_t ticks) noexcept {
+            return ticks;
+        }
+    };
+
+    #if defined(__x86_64__) || defined(_M_X64)
+    /**
+     * Reads the time stamp counter, a handful of cycles instead of a clock_gettime call
+     * Calibrated against steady_clock by spinning for 10ms the first time ticks are converted,
+     * which assumes the invariant TSC every x86 CPU of the last decade has
+     */
+    struct tsc_ticks {
+        struct calibration {
+            uint64_t base_ticks;
+            uint64_t base_ns;
+            double ns_per_tick;
+        };
+
+        [[nodiscard]] static const calibration& calibrated() noexcept {
+            static const calibration result = [] {
+                const auto start_ticks = __rdtsc();
+                const auto start_ns = steady_ticks::now();
+                auto end_ns = start_ns;
+                while (end_ns - start_ns < 10'000'000) end_ns = steady_ticks::now();
+                const auto end_ticks = __rdtsc();
+                return calibration{start_ticks, start_ns, static_cast<double>(end_ns - start_ns) / static_cast<double>(end_ticks - start_ticks)};
+            }();
+            return result;
+        }
+
+        [[nodiscard]] static uint64_t now() noexcept {
+            return __rdtsc();
+        }
+
+        [[nodiscard]] static uint64_t to_ns(const uint64_t ticks) noexcept {
+            return static_cast<uint64_t>(static_cast<double>(ticks) * calibrated().ns_per_tick);
+        }
+
+        [[nodiscard]] static uint64_t to_steady_ns(const uint64_t ticks) noexcept {
+            const auto& c = calibrated();
+            return c.base_ns + static_cast<uint64_t>(static_cast<double>(static_cast<int64_t>(ticks - c.base_ticks)) * c.ns_per_tick);
+        }
+    };
+    #else
+    using tsc_ticks = steady_ticks;
+    #endif
+
+    /**
+     * Clock used by USYLIBPP_PROFILE_SCOPE, define USYLIBPP_PROFILING_TSC to switch it to the time stamp counter
+     */
+    #ifdef USYLIBPP_PROFILING_TSC
+    using profile_clock = tsc_ticks;
+    #else
+    using profile_clock = steady_ticks;
+    #endif
+
+    enum class metric_kind : uint8_t {
+        counter,
+        histogram,
+        timer
+    };
+
+    namespace internal {
+        inline constexpr size_t max_metrics = 4096;
+        inline constexpr size_t metrics_per_chunk = 64;
+        inline constexpr size_t trace_capacity = size_t{1} << 16;
+
+        /**
+         * Log linear buckets, exact below 16 and 16 sub buckets per power of two above, so percentiles are within about 6%
+         */
+        inline constexpr size_t histogram_sub_bits = 4;
+        inline constexpr size_t histogram_buckets = (64 - histogram_sub_bits + 1) << histogram_sub_bits;
+
+        [[nodiscard]] inline constexpr size_t bucket_of(const uint64_t value) noexcept {
+            constexpr uint64_t sub = uint64_t{1} << histogram_sub_bits;
+            if (value < sub) return static_cast<size_t>(value);
+            const auto exponent = static_cast<size_t>(std::bit_width(value)) - 1;
+            return ((exponent - histogram_sub_bits + 1) << histogram_sub_bits) + static_cast<size_t>((value >> (exponent - histogram_sub_bits)) & (sub - 1));
+        }
+
+        [[nodiscard]] inline constexpr uint64_t bucket_lower(const size_t bucket) noexcept {
+            constexpr size_t sub = size_t{1} << histogram_sub_bits;
+            if (bucket < sub) return bucket;
+            const auto exponent = (bucket >> histogram_sub_bits) + histogram_sub_bits - 1;
+            return static_cast<uint64_t>(sub + (bucket & (sub - 1))) << (exponent - histogram_sub_bits);
+        }
+
+        [[nodiscard]] inline constexpr uint64_t bucket_width(const size_t bucket) noexcept {
+            constexpr size_t sub = size_t{1} << histogram_sub_bits;
+            if (bucket < sub) return 1;
+            return uint64_t{1} << ((bucket >> histogram_sub_bits) - 1);
+        }
+
+        /**
+         * Only the owning thread writes, so updates are a relaxed load and store instead of a locked read modify write
+         */
+        inline void bump(std::atomic<uint64_t>& value, const uint64_t n) noexcept {
+            value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+        }
+
+        struct slot {
+            std::atomic<uint64_t> count{0};
+            std::atomic<uint64_t> sum{0};
+            std::atomic<uint64_t> min{std::numeric_limits<uint64_t>::max()};
+            std::atomic<uint64_t> max{0};
+            std::atomic<std::atomic<uint64_t>*> buckets{nullptr};
+        };
+
+        struct chunk {
+            std::array<slot, metrics_per_chunk> slots;
+            std::array<std::unique_ptr<std::atomic<uint64_t>[]>, metrics_per_chunk> bucket_storage;
+        };
+
+        struct trace_event {
+            std::atomic<uint64_t> start{0};
+            std::atomic<uint64_t> duration{0};
+            std::atomic<uint32_t> id{0};
+        };
+
+        /**
+         * Everything one thread has recorded, written lock free by that thread and read by dump and write_chrome_trace
+         * Handed to the next new thread once its owner exits, so short lived pool threads do not pile up states
+         */
+        struct thread_state {
+            uint32_t index = 0;
+            std::array<std::atomic<chunk*>, max_metrics / metrics_per_chunk> chunks{};
+            std::unique_ptr<chunk> chunk_storage[max_metrics / metrics_per_chunk];
+            std::unique_ptr<trace_event[]> event_storage;
+            std::atomic<trace_event*> events{nullptr};
+            std::atomic<uint64_t> event_count{0};
+
+            [[nodiscard]] slot& slot_of(const uint32_t id, const bool with_buckets) {
+                auto* c = chunks[id / metrics_per_chunk].load(std::memory_order_relaxed);
+                if (!c) {
+                    chunk_storage[id / metrics_per_chunk] = std::make_unique<chunk>();
+                    c = chunk_storage[id / metrics_per_chunk].get();
+                    chunks[id / metrics_per_chunk].store(c, std::memory_order_release);
+                }
+
+                auto& s = c->slots[id % metrics_per_chunk];
+                if (with_buckets && !s.buckets.load(std::memory_order_relaxed)) {
+                    auto& storage = c->bucket_storage[id % metrics_per_chunk];
+                    storage = std::make_unique<std::atomic<uint64_t>[]>(histogram_buckets);
+                    s.buckets.store(storage.get(), std::memory_order_release);
+                }
+                return s;
+            }
+
+            /**
+             * Keeps the most recent trace_capacity events
+             */
+            void add_event(const uint32_t id, const uint64_t start_ns, const uint64_t duration_ns) {
+                auto* ring = events.load(std::memory_order_relaxed);
+                if (!ring) {
+                    event_storage = std::make_unique<trace_event[]>(trace_capacity);
+                    ring = event_storage.get();
+                    events.store(ring, std::memory_order_release);
+                }
+
+                const auto n = event_count.load(std::memory_order_relaxed);
+                auto& event = ring[n % trace_capacity];
+                event.start.store(start_ns, std::memory_order_relaxed);
+                event.duration.store(duration_ns, std::memory_order_relaxed);
+                event.id.store(id, std::memory_order_relaxed);
+                event_count.store(n + 1, std::memory_order_release);
+            }
+        };
+
+        struct metric {
+            std::string name;
+            metric_kind kind;
+        };
+
+        class registry {
+        private:
+            std::vector<std::unique_ptr<thread_state>> threads;
+            std::vector<thread_state*> free_threads;
+            std::unordered_map<std::string, uint32_t> ids;
+        public:
+            std::mutex mutex;
+            std::vector<metric> metrics;
+            std::atomic<bool> tracing{false};
+
+            /**
+             * Never destroyed, threads that outlive static destruction can still record
+             */
+            [[nodiscard]] static registry& instance() {
+                static auto* reg = new registry;
+                return *reg;
+            }
+
+            /**
+             * Returns max_metrics once the table is full, recording against that id does nothing
+             */
+            [[nodiscard]] uint32_t id_of(const std::string_view name, const metric_kind kind) {
+                std::lock_guard lock{mutex};
+                const auto [it, inserted] = ids.try_emplace(std::string{name}, static_cast<uint32_t>(metrics.size()));
+                if (inserted) {
+                    if (metrics.size() == max_metrics) {
+                        ids.erase(it);
+                        return max_metrics;
+                    }
+                    metrics.push_back({std::string{name}, kind});
+                }
+                return it->second;
+            }
+
+            [[nodiscard]] thread_state* attach() {
+                std::lock_guard lock{mutex};
+                if (!free_threads.empty()) {
+                    auto* state = free_threads.back();
+                    free_threads.pop_back();
+                    return state;
+                }
+                threads.push_back(std::make_unique<thread_state>());
+                threads.back()->index = static_cast<uint32_t>(threads.size());
+                return threads.back().get();
+            }
+
+            void detach(thread_state* state) {
+                std::lock_guard lock{mutex};
+                free_threads.push_back(state);
+            }
+
+            /**
+             * Call with mutex held
+             */
+            template <typename F>
+            void for_each_thread(F&& f) const {
+                for (const auto& state : threads) f(*state);
+            }
+        };
+
+        struct thread_handle {
+            thread_state* state = registry::instance().attach();
+
+            ~thread_handle() {
+                registry::instance().detach(state);
+            }
+        };
+
+        [[nodiscard]] inline thread_state& this_thread() {
+            static thread_local thread_handle handle;
+            return *handle.state;
+        }
+
+        inline void record(const uint32_t id, const uint64_t value) {
+            if (id >= max_metrics) return;
+            auto& s = this_thread().slot_of(id, true);
+            bump(s.count, 1);
+            bump(s.sum, value);
+            if (value < s.min.load(std::memory_order_relaxed)) s.min.store(value, std::memory_order_relaxed);
+            if (value > s.max.load(std::memory_order_relaxed)) s.max.store(value, std::memory_order_relaxed);
+            bump(s.buckets.load(std::memory_order_relaxed)[bucket_of(value)], 1);
+        }
+    }
+
+    /**
+     * Named running total, instances with the same name share it
+     * Keep the object around (the macros use a function local static), construction takes a lock and adding does not
+     */
+    class counter {
+    private:
+        uint32_t id;
+    public:
+        explicit counter(const std::string_view name) : id(internal::registry::instance().id_of(name, metric_kind::counter)) {}
+
+        void add(const uint64_t n = 1) const {
+            if (id >= internal::max_metrics) return;
+            auto& s = internal::this_thread().slot_of(id, false);
+            internal::bump(s.count, 1);
+            internal::bump(s.sum, n);
+        }
+    };
+
+    /**
+     * Named distribution of values, dump reports count, mean, percentiles and extremes
+     */
+    class histogram {
+    private:
+        uint32_t id;
+    public:
+        explicit histogram(const std::string_view name) : id(internal::registry::instance().id_of(name, metric_kind::histogram)) {}
+
+        void record(const uint64_t value) const {
+            internal::record(id, value);
+        }
+    };
+
+    /**
+     * A histogram of durations in nanoseconds, filled by scoped_timer
+     */
+    class timer {
+    private:
+        uint32_t id;
+
+        template <typename Clock>
+        friend class scoped_timer;
+    public:
+        explicit timer(const std::string_view name) : id(internal::registry::instance().id_of(name, metric_kind::timer)) {}
+
+        void record(const uint64_t ns) const {
+            internal::record(id, ns);
+        }
+    };
+
+    /**
+     * Records the time from construction to destruction (or stop) into a timer
+     * With set_tracing(true) every measured scope also becomes an event for write_chrome_trace
+     */
+    template <typename Clock = profile_clock>
+    class scoped_timer {
+    private:
+        const timer* target;
+        uint64_t start;
+    public:
+        explicit scoped_timer(const timer& target) noexcept : target(&target), start(Clock::now()) {}
+
+        scoped_timer(const scoped_timer&) = delete;
+        scoped_timer& operator=(const scoped_timer&) = delete;
+
+        ~scoped_timer() {
+            stop();
+        }
+
+        /**
+         * Records now instead of at the end of the scope, later calls do nothing
+         */
+        void stop() {
+            if (!target) return;
+            const auto end = Clock::now();
+            const auto ns = Clock::to_ns(end - start);
+            internal::record(target->id, ns);
+            if (target->id < internal::max_metrics && internal::registry::instance().tracing.load(std::memory_order_relaxed)) {
+                internal::this_thread().add_event(target->id, Clock::to_steady_ns(start), ns);
+            }
+            target = nullptr;
+        }
+    };
+
+    /**
+     * Turns collection of trace events on or off for all threads, each thread allocates its event ring on first use
+     */
+    inline void set_tracing(const bool enabled) noexcept {
+        internal::registry::instance().tracing.store(enabled, std::memory_order_relaxed);
+    }
+
+    struct metric_summary {
+        std::string name;
+        metric_kind kind;
+        uint64_t count;
+        /**
+         * The total for counters
+         */
+        uint64_t sum;
+        uint64_t min;
+        uint64_t max;
+        uint64_t p50;
+        uint64_t p90;
+        uint64_t p99;
+
+        [[nodiscard]] double mean() const noexcept {
+            return count == 0 ? 0.0 : static_cast<double>(sum) / static_cast<double>(count);
+        }
+    };
+
+    /**
+     * Merges every thread's numbers, threads keep recording while this runs so the figures are a close approximation
+     */
+    [[nodiscard]] inline std::vector<metric_summary> snapshot() {
+        auto& reg = internal::registry::instance();
+        std::lock_guard lock{reg.mutex};
+
+        std::vector<metric_summary> result;
+        std::vector<uint64_t> buckets(internal::histogram_buckets);
+        for (uint32_t id = 0; id < reg.metrics.size(); ++id) {
+            metric_summary summary{reg.metrics[id].name, reg.metrics[id].kind, 0, 0, std::numeric_limits<uint64_t>::max(), 0, 0, 0, 0};
+            std::fill(buckets.begin(), buckets.end(), 0);
+
+            reg.for_each_thread([&](const internal::thread_state& state) {
+                const auto* c = state.chunks[id / internal::metrics_per_chunk].load(std::memory_order_acquire);
+                if (!c) return;
+                const auto& s = c->slots[id % internal::metrics_per_chunk];
+                summary.count += s.count.load(std::memory_order_relaxed);
+                summary.sum += s.sum.load(std::memory_order_relaxed);
+                summary.min = std::min(summary.min, s.min.load(std::memory_order_relaxed));
+                summary.max = std::max(summary.max, s.max.load(std::memory_order_relaxed));
+                if (const auto* b = s.buckets.load(std::memory_order_acquire)) {
+                    for (size_t i = 0; i < internal::histogram_buckets; ++i) buckets[i] += b[i].load(std::memory_order_relaxed);
+                }
+            });
+
+            if (summary.count == 0 || summary.kind == metric_kind::counter) summary.min = 0;
+            if (summary.kind != metric_kind::counter && summary.count > 0) {
+                const auto percentile = [&](const double p) {
+                    const auto rank = static_cast<uint64_t>(p * static_cast<double>(summary.count - 1)) + 1;
+                    uint64_t seen = 0;
+                    for (size_t i = 0; i < internal::histogram_buckets; ++i) {
+                        seen += buckets[i];
+                        if (seen >= rank) return std::clamp(internal::bucket_lower(i) + internal::bucket_width(i) / 2, summary.min, summary.max);
+                    }
+                    return summary.max;
+                };
+                summary.p50 = percentile(0.50);
+                summary.p90 = percentile(0.90);
+                summary.p99 = percentile(0.99);
+            }
+            result.push_back(std::move(summary));
+        }
+        return result;
+    }
+
+    /**
+     * Zeroes every metric, meant for between phases, values recorded concurrently with the reset may survive it
+     */
+    inline void reset() {
+        auto& reg = internal::registry::instance();
+        std::lock_guard lock{reg.mutex};
+        reg.for_each_thread([](internal::thread_state& state) {
+            for (auto& c : state.chunks) {
+                auto* chunk = c.load(std::memory_order_acquire);
+                if (!chunk) continue;
+                for (auto& s : chunk->slots) {
+                    s.count.store(0, std::memory_order_relaxed);
+                    s.sum.store(0, std::memory_order_relaxed);
+                    s.min.store(std::numeric_limits<uint64_t>::max(), std::memory_order_relaxed);
+                    s.max.store(0, std::memory_order_relaxed);
+                    if (auto* b = s.buckets.load(std::memory_order_acquire)) {
+                        for (size_t i = 0; i < internal::histogram_buckets; ++i) b[i].store(0, std::memory_order_relaxed);
+                    }
+                }
+            }
+            state.event_count.store(0, std::memory_order_relaxed);
+        });
+    }
+
+    namespace internal {
+        /**
+         * Writes " label duration" with the largest unit that keeps the number above 1
+         */
+        inline void write_duration(std::FILE* out, const char* label, const double ns) {
+            if (ns < 1e3) std::fprintf(out, " %s %.0fns", label, ns);
+            else if (ns < 1e6) std::fprintf(out, " %s %.2fus", label, ns / 1e3);
+            else if (ns < 1e9) std::fprintf(out, " %s %.2fms", label, ns / 1e6);
+            else std::fprintf(out, " %s %.2fs", label, ns / 1e9);
+        }
+
+        inline void write_json_string(std::FILE* out, const std::string_view text) {
+            std::fputc('"', out);
+            for (const char c : text) {
+                if (c == '"' || c == '\\') {
+                    std::fputc('\\', out);
+                    std::fputc(c, out);
+                } else if (static_cast<unsigned char>(c) < 0x20) {
+                    std::fprintf(out, "\\u%04x", static_cast<unsigned>(c));
+                } else {
+                    std::fputc(c, out);
+                }
+            }
+            std::fputc('"', out);
+        }
+    }
+
+    /**
+     * One line per metric, timers are shown as durations
+     * Formatted with stdio so profiling does not pull print.hpp and std::format into every user
+     */
+    inline void dump(std::FILE* stream = stdout) {
+        using ull = unsigned long long;
+        for (const auto& m : snapshot()) {
+            std::fprintf(stream, "%-32s", m.name.c_str());
+            switch (m.kind) {
+            case metric_kind::counter:
+                std::fprintf(stream, " total %llu", static_cast<ull>(m.sum));
+                break;
+            case metric_kind::histogram:
+                std::fprintf(stream, " n %llu mean %.1f p50 %llu p90 %llu p99 %llu min %llu max %llu", static_cast<ull>(m.count), m.mean(),
+                    static_cast<ull>(m.p50), static_cast<ull>(m.p90), static_cast<ull>(m.p99), static_cast<ull>(m.min), static_cast<ull>(m.max));
+                break;
+            case metric_kind::timer:
+                std::fprintf(stream, " n %llu", static_cast<ull>(m.count));
+                internal::write_duration(stream, "total", static_cast<double>(m.sum));
+                internal::write_duration(stream, "mean", m.mean());
+                internal::write_duration(stream, "p50", static_cast<double>(m.p50));
+                internal::write_duration(stream, "p90", static_cast<double>(m.p90));
+                internal::write_duration(stream, "p99", static_cast<double>(m.p99));
+                internal::write_duration(stream, "max", static_cast<double>(m.max));
+                break;
+            }
+            std::fputc('\n', stream);
+        }
+    }
+
+    /**
+     * Writes the trace events collected since set_tracing(true) in the Chrome trace event format,
+     * open it in chrome://tracing or Perfetto, counter totals are added as counter events at the end
+     * Events recorded while this runs may be missing, returns false if the file cannot be written
+     */
+    [[nodiscard]] inline bool write_chrome_trace(const std::filesystem::path& path) {
+        #ifdef WIN32
+        std::FILE* out = _wfopen(path.c_str(), L"wb");
+        #else
+        std::FILE* out = std::fopen(path.c_str(), "wb");
+        #endif
+        if (!out) return false;
+
+        const auto summaries = snapshot();
+        auto& reg = internal::registry::instance();
+        uint64_t last_ns = 0;
+        bool first = true;
+        const auto separator = [&] {
+            std::fputs(first ? "\n" : ",\n", out);
+            first = false;
+        };
+
+        std::fputs("{\"traceEvents\": [", out);
+        {
+            std::lock_guard lock{reg.mutex};
+            reg.for_each_thread([&](const internal::thread_state& state) {
+                separator();
+                std::fprintf(out, "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %u, \"args\": {\"name\": \"thread %u\"}}", state.index, state.index);
+
+                const auto* ring = state.events.load(std::memory_order_acquire);
+                if (!ring) return;
+                const auto count = state.event_count.load(std::memory_order_acquire);
+                for (auto n = count > internal::trace_capacity ? count - internal::trace_capacity : 0; n < count; ++n) {
+                    const auto& event = ring[n % internal::trace_capacity];
+                    const auto id = event.id.load(std::memory_order_relaxed);
+                    if (id >= reg.metrics.size()) continue;
+                    const auto start = event.start.load(std::memory_order_relaxed);
+                    const auto duration = event.duration.load(std::memory_order_relaxed);
+                    last_ns = std::max(last_ns, start + duration);
+
+                    separator();
+                    std::fputs("{\"name\": ", out);
+                    internal::write_json_string(out, reg.metrics[id].name);
+                    std::fprintf(out, ", \"cat\": \"usylibpp\", \"ph\": \"X\", \"pid\": 1, \"tid\": %u, \"ts\": %.3f, \"dur\": %.3f}",
+                        state.index, static_cast<double>(start) / 1e3, static_cast<double>(duration) / 1e3);
+                }
+            });
+        }
+
+        for (const auto& m : summaries) {
+            if (m.kind != metric_kind::counter) continue;
+            separator();
+            std::fputs("{\"name\": ", out);
+            internal::write_json_string(out, m.name);
+            std::fprintf(out, ", \"ph\": \"C\", \"pid\": 1, \"ts\": %.3f, \"args\": {\"value\": %llu}}", static_cast<double>(last_ns) / 1e3, static_cast<unsigned long long>(m.sum));
+        }
+        std::fputs("\n]}\n", out);
+
+        const bool ok = !std::ferror(out);
+        return std::fclose(out) == 0 && ok;
+    }
+}
+
+#define USYLIBPP_PROFILE_CONCAT_INNER(a, b) a##b
+#define USYLIBPP_PROFILE_CONCAT(a, b) USYLIBPP_PROFILE_CONCAT_INNER(a, b)
+
+/**
+ * Instrumentation that disappears, arguments included, unless USYLIBPP_ENABLE_PROFILING is defined
+ * USYLIBPP_PROFILE_SCOPE times the rest of the enclosing scope, at most one per line
+ */
+#ifdef USYLIBPP_ENABLE_PROFILING
+#define USYLIBPP_PROFILE_SCOPE(name) \
+    static const ::usylibpp::time::timer USYLIBPP_PROFILE_CONCAT(usylibpp_profile_timer_, __LINE__){name}; \
+    const ::usylibpp::time::scoped_timer<> USYLIBPP_PROFILE_CONCAT(usylibpp_profile_scope_, __LINE__){USYLIBPP_PROFILE_CONCAT(usylibpp_profile_timer_, __LINE__)}
+#define USYLIBPP_PROFILE_COUNT(name, n) \
+    do { static const ::usylibpp::time::counter usylibpp_profile_counter{name}; usylibpp_profile_counter.add(n); } while (false)
+#define USYLIBPP_PROFILE_RECORD(name, value) \
+    do { static const ::usylibpp::time::histogram usylibpp_profile_histogram{name}; usylibpp_profile_histogram.record(value); } while (false)
+#else
+#define USYLIBPP_PROFILE_SCOPE(name) static_assert(true)
+#define USYLIBPP_PROFILE_COUNT(name, n) do {} while (false)
+#define USYLIBPP_PROFILE_RECORD(name, value) do {} while (false)
+#endif
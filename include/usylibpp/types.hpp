@@ -3,6 +3,7 @@
 #include <string_view>
 #include <string>
 #include <filesystem>
+#include <concepts>
 
 namespace usylibpp::types {
     template<typename T, typename Char>
@@ -38,4 +39,27 @@ namespace usylibpp::types {
         std::same_as<std::remove_cvref_t<T>, unsigned int> || 
         std::same_as<std::remove_cvref_t<T>, unsigned long> || 
         std::same_as<std::remove_cvref_t<T>, unsigned long long>;
+
+    template <typename T>
+    concept SignedInteger =
+        std::same_as<std::remove_cvref_t<T>, signed char> || 
+        std::same_as<std::remove_cvref_t<T>, short> || 
+        std::same_as<std::remove_cvref_t<T>, int> || 
+        std::same_as<std::remove_cvref_t<T>, long> || 
+        std::same_as<std::remove_cvref_t<T>, long long>;
+
+    template <typename T>
+    concept Integer = UnsignedInteger<T> || SignedInteger<T>;
+
+    template <typename T>
+    concept FloatingPoint =
+        std::same_as<std::remove_cvref_t<T>, float> || 
+        std::same_as<std::remove_cvref_t<T>, double> || 
+        std::same_as<std::remove_cvref_t<T>, long double>;
+
+    /**
+     * Anything std::from_chars / std::to_chars can handle, char and bool are deliberately left out
+     */
+    template <typename T>
+    concept Number = Integer<T> || FloatingPoint<T>;
 }
\ No newline at end of file
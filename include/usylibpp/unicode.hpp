@@ -0,0 +1,600 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include "simd.hpp"
+
+/**
+ * Portable transcoding between UTF-8, UTF-16, UTF-32 and std::wstring (UTF-16 on Windows, UTF-32 elsewhere)
+ * Every conversion validates, invalid input gives std::nullopt instead of replacement characters
+ * ASCII runs are found and widened or narrowed a vector at a time, only the rest goes through the scalar decoder
+ */
+namespace usylibpp::unicode {
+    /**
+     * Returns the length of the sequence at p and stores the code point in out, 0 if the sequence is invalid
+     * Overlong forms, surrogates and values past U+10FFFF are invalid
+     */
+    [[nodiscard]] inline constexpr size_t decode_utf8(const char* p, const size_t size, char32_t& out) noexcept {
+        const auto b0 = static_cast<unsigned char>(p[0]);
+        if (b0 < 0x80) {
+            out = b0;
+            return 1;
+        }
+
+        size_t length;
+        char32_t min;
+        if ((b0 & 0xE0) == 0xC0) {
+            length = 2;
+            min = 0x80;
+            out = b0 & 0x1F;
+        } else if ((b0 & 0xF0) == 0xE0) {
+            length = 3;
+            min = 0x800;
+            out = b0 & 0x0F;
+        } else if ((b0 & 0xF8) == 0xF0) {
+            length = 4;
+            min = 0x10000;
+            out = b0 & 0x07;
+        } else {
+            return 0;
+        }
+        if (size < length) return 0;
+
+        for (size_t i = 1; i < length; ++i) {
+            const auto b = static_cast<unsigned char>(p[i]);
+            if ((b & 0xC0) != 0x80) return 0;
+            out = (out << 6) | (b & 0x3F);
+        }
+
+        if (out < min || out > 0x10FFFF || (out >= 0xD800 && out <= 0xDFFF)) return 0;
+        return length;
+    }
+
+    /**
+     * out needs room for 4 bytes, returns the number written
+     */
+    [[nodiscard]] inline constexpr size_t encode_utf8(const char32_t c, char* out) noexcept {
+        if (c < 0x80) {
+            out[0] = static_cast<char>(c);
+            return 1;
+        }
+        if (c < 0x800) {
+            out[0] = static_cast<char>(0xC0 | (c >> 6));
+            out[1] = static_cast<char>(0x80 | (c & 0x3F));
+            return 2;
+        }
+        if (c < 0x10000) {
+            out[0] = static_cast<char>(0xE0 | (c >> 12));
+            out[1] = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+            out[2] = static_cast<char>(0x80 | (c & 0x3F));
+            return 3;
+        }
+        out[0] = static_cast<char>(0xF0 | (c >> 18));
+        out[1] = static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+        out[2] = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+        out[3] = static_cast<char>(0x80 | (c & 0x3F));
+        return 4;
+    }
+
+    namespace internal {
+        /**
+         * Returns how many code units of src make up the code point and stores it in out, 0 if invalid
+         * 16 bit units are UTF-16 with surrogate pairs, 32 bit units are UTF-32
+         */
+        template <typename Unit>
+        [[nodiscard]] inline constexpr size_t decode_unit(const Unit* src, const size_t size, char32_t& out) noexcept {
+            const auto c = static_cast<char32_t>(static_cast<std::make_unsigned_t<Unit>>(src[0]));
+            if constexpr (sizeof(Unit) == 2) {
+                if (c < 0xD800 || c > 0xDFFF) {
+                    out = c;
+                    return 1;
+                }
+                if (c > 0xDBFF || size < 2) return 0;
+                const auto low = static_cast<char32_t>(static_cast<std::make_unsigned_t<Unit>>(src[1]));
+                if (low < 0xDC00 || low > 0xDFFF) return 0;
+                out = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+                return 2;
+            } else {
+                if (c > 0x10FFFF || (c >= 0xD800 && c <= 0xDFFF)) return 0;
+                out = c;
+                return 1;
+            }
+        }
+
+        /**
+         * out needs room for 2 units, returns the number written
+         */
+        template <typename Unit>
+        [[nodiscard]] inline constexpr size_t encode_unit(const char32_t c, Unit* out) noexcept {
+            if constexpr (sizeof(Unit) == 2) {
+                if (c >= 0x10000) {
+                    out[0] = static_cast<Unit>(0xD800 + ((c - 0x10000) >> 10));
+                    out[1] = static_cast<Unit>(0xDC00 + ((c - 0x10000) & 0x3FF));
+                    return 2;
+                }
+            }
+            out[0] = static_cast<Unit>(c);
+            return 1;
+        }
+
+        /**
+         * Converts UTF-8 into Unit, writing only what fits in capacity, dst may be nullptr to measure
+         * Returns the full converted length or std::nullopt on invalid input
+         */
+        template <typename Unit>
+        [[nodiscard]] inline std::optional<size_t> from_utf8(const std::string_view src, Unit* dst, const size_t capacity) noexcept {
+            size_t written = 0;
+            size_t i = 0;
+            while (i < src.size()) {
+                const auto run = simd::find_non_ascii(src.data() + i, src.size() - i);
+                if (run > 0) {
+                    if (written + run <= capacity) simd::widen_ascii(src.data() + i, dst + written, run);
+                    written += run;
+                    i += run;
+                    if (i == src.size()) break;
+                }
+
+                char32_t c = 0;
+                const auto length = decode_utf8(src.data() + i, src.size() - i, c);
+                if (length == 0) return std::nullopt;
+                i += length;
+
+                Unit encoded[2];
+                const auto encoded_length = encode_unit(c, encoded);
+                if (written + encoded_length <= capacity) {
+                    for (size_t j = 0; j < encoded_length; ++j) dst[written + j] = encoded[j];
+                }
+                written += encoded_length;
+            }
+            return written;
+        }
+
+        /**
+         * Converts Unit into UTF-8, same contract as from_utf8
+         */
+        template <typename Unit>
+        [[nodiscard]] inline std::optional<size_t> to_utf8(const std::basic_string_view<Unit> src, char* dst, const size_t capacity) noexcept {
+            size_t written = 0;
+            size_t i = 0;
+            while (i < src.size()) {
+                // once out of room the rest is only measured
+                const bool fits = written < capacity;
+                const auto run = simd::narrow_ascii(src.data() + i, fits ? dst + written : nullptr, fits ? std::min(src.size() - i, capacity - written) : src.size() - i);
+                written += run;
+                i += run;
+                if (i == src.size()) break;
+
+                char32_t c = 0;
+                const auto length = decode_unit(src.data() + i, src.size() - i, c);
+                if (length == 0) return std::nullopt;
+                i += length;
+
+                char encoded[4];
+                const auto encoded_length = encode_utf8(c, encoded);
+                if (written + encoded_length <= capacity) {
+                    for (size_t j = 0; j < encoded_length; ++j) dst[written + j] = encoded[j];
+                }
+                written += encoded_length;
+            }
+            return written;
+        }
+
+        template <typename String>
+        [[nodiscard]] inline std::optional<String> allocate_from_utf8(const std::string_view src) {
+            const auto length = from_utf8<typename String::value_type>(src, nullptr, 0);
+            if (!length) return std::nullopt;
+
+            String result(*length, typename String::value_type{});
+            (void) from_utf8(src, result.data(), result.size());
+            return result;
+        }
+
+        template <typename Unit>
+        [[nodiscard]] inline std::optional<std::string> allocate_to_utf8(const std::basic_string_view<Unit> src) {
+            const auto length = to_utf8(src, nullptr, 0);
+            if (!length) return std::nullopt;
+
+            std::string result(*length, '\0');
+            (void) to_utf8(src, result.data(), result.size());
+            return result;
+        }
+
+        [[nodiscard]] inline std::optional<size_t> into(const std::optional<size_t> length, const size_t capacity) noexcept {
+            if (!length || *length > capacity) return std::nullopt;
+            return length;
+        }
+    }
+
+    /**
+     * Exact number of UTF-16 code units utf8 converts to, std::nullopt if it is not valid UTF-8
+     */
+    [[nodiscard]] inline std::optional<size_t> utf16_length(const std::string_view utf8) noexcept {
+        return internal::from_utf8<char16_t>(utf8, nullptr, 0);
+    }
+
+    /**
+     * Exact number of code points in utf8, std::nullopt if it is not valid UTF-8
+     */
+    [[nodiscard]] inline std::optional<size_t> utf32_length(const std::string_view utf8) noexcept {
+        return internal::from_utf8<char32_t>(utf8, nullptr, 0);
+    }
+
+    /**
+     * Exact number of wchar_t units utf8 converts to, std::nullopt if it is not valid UTF-8
+     */
+    [[nodiscard]] inline std::optional<size_t> wstring_length(const std::string_view utf8) noexcept {
+        return internal::from_utf8<wchar_t>(utf8, nullptr, 0);
+    }
+
+    /**
+     * Exact number of bytes the UTF-8 form takes, std::nullopt on unpaired surrogates
+     */
+    [[nodiscard]] inline std::optional<size_t> utf8_length(const std::u16string_view utf16) noexcept {
+        return internal::to_utf8(utf16, nullptr, 0);
+    }
+
+    [[nodiscard]] inline std::optional<size_t> utf8_length(const std::u32string_view utf32) noexcept {
+        return internal::to_utf8(utf32, nullptr, 0);
+    }
+
+    [[nodiscard]] inline std::optional<size_t> utf8_length(const std::wstring_view wide) noexcept {
+        return internal::to_utf8(wide, nullptr, 0);
+    }
+
+    /**
+     * Writes the conversion into out and returns the number of units written
+     * std::nullopt if the input is invalid or out is too small, what was written so far is unspecified
+     */
+    [[nodiscard]] inline std::optional<size_t> to_utf16_into(const std::string_view utf8, const std::span<char16_t> out) noexcept {
+        return internal::into(internal::from_utf8(utf8, out.data(), out.size()), out.size());
+    }
+
+    [[nodiscard]] inline std::optional<size_t> to_utf32_into(const std::string_view utf8, const std::span<char32_t> out) noexcept {
+        return internal::into(internal::from_utf8(utf8, out.data(), out.size()), out.size());
+    }
+
+    [[nodiscard]] inline std::optional<size_t> to_wstring_into(const std::string_view utf8, const std::span<wchar_t> out) noexcept {
+        return internal::into(internal::from_utf8(utf8, out.data(), out.size()), out.size());
+    }
+
+    [[nodiscard]] inline std::optional<size_t> to_utf8_into(const std::u16string_view utf16, const std::span<char> out) noexcept {
+        return internal::into(internal::to_utf8(utf16, out.data(), out.size()), out.size());
+    }
+
+    [[nodiscard]] inline std::optional<size_t> to_utf8_into(const std::u32string_view utf32, const std::span<char> out) noexcept {
+        return internal::into(internal::to_utf8(utf32, out.data(), out.size()), out.size());
+    }
+
+    [[nodiscard]] inline std::optional<size_t> to_utf8_into(const std::wstring_view wide, const std::span<char> out) noexcept {
+        return internal::into(internal::to_utf8(wide, out.data(), out.size()), out.size());
+    }
+
+    /**
+     * Allocates once, the exact length is measured first
+     * Unlike windows::to_wstr an empty input gives an empty string, std::nullopt only means invalid input
+     */
+    [[nodiscard]] inline std::optional<std::u16string> to_utf16(const std::string_view utf8) {
+        return internal::allocate_from_utf8<std::u16string>(utf8);
+    }
+
+    [[nodiscard]] inline std::optional<std::u32string> to_utf32(const std::string_view utf8) {
+        return internal::allocate_from_utf8<std::u32string>(utf8);
+    }
+
+    [[nodiscard]] inline std::optional<std::wstring> to_wstring(const std::string_view utf8) {
+        return internal::allocate_from_utf8<std::wstring>(utf8);
+    }
+
+    [[nodiscard]] inline std::optional<std::string> to_utf8(const std::u16string_view utf16) {
+        return internal::allocate_to_utf8(utf16);
+    }
+
+    [[nodiscard]] inline std::optional<std::string> to_utf8(const std::u32string_view utf32) {
+        return internal::allocate_to_utf8(utf32);
+    }
+
+    [[nodiscard]] inline std::optional<std::string> to_utf8(const std::wstring_view wide) {
+        return internal::allocate_to_utf8(wide);
+    }
+
+    /**
+     * Converts to true when the input is valid
+     */
+    struct validation_result {
+        bool valid = true;
+
+        /**
+         * Offset of the first byte of the first invalid or truncated sequence, the input size when valid
+         */
+        size_t error_offset = 0;
+
+        explicit operator bool() const noexcept {
+            return valid;
+        }
+    };
+
+    namespace internal {
+        [[nodiscard]] inline validation_result validate_scalar(const char* data, const size_t size, size_t i) noexcept {
+            while (i < size) {
+                i += simd::find_non_ascii(data + i, size - i);
+                if (i == size) break;
+
+                char32_t c = 0;
+                const auto length = decode_utf8(data + i, size - i, c);
+                if (length == 0) return {false, i};
+                i += length;
+            }
+            return {true, size};
+        }
+
+        /**
+         * Start of the sequence that i falls in or right after, assuming everything before i is valid
+         */
+        [[nodiscard]] inline size_t sequence_start(const char* data, const size_t i) noexcept {
+            for (size_t back = 1; back <= 3 && back <= i; ++back) {
+                if ((static_cast<unsigned char>(data[i - back]) & 0xC0) != 0x80) return i - back;
+            }
+            return i;
+        }
+
+        #if USYLIBPP_SIMD_LEVEL >= 2
+        struct utf8_vec {
+            using type = __m256i;
+            static constexpr size_t width = 32;
+
+            static type load(const void* p) noexcept { return _mm256_loadu_si256(static_cast<const __m256i*>(p)); }
+            static type zero() noexcept { return _mm256_setzero_si256(); }
+            static type set1(const uint8_t b) noexcept { return _mm256_set1_epi8(static_cast<char>(b)); }
+            static type table(const uint8_t* t) noexcept { return _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(t))); }
+            static type lookup(const type t, const type index) noexcept { return _mm256_shuffle_epi8(t, index); }
+            static type high_nibble(const type x) noexcept { return _mm256_and_si256(_mm256_srli_epi16(x, 4), set1(0x0F)); }
+            static type low_nibble(const type x) noexcept { return _mm256_and_si256(x, set1(0x0F)); }
+            static type and_(const type a, const type b) noexcept { return _mm256_and_si256(a, b); }
+            static type or_(const type a, const type b) noexcept { return _mm256_or_si256(a, b); }
+            static type xor_(const type a, const type b) noexcept { return _mm256_xor_si256(a, b); }
+            static type subs(const type a, const type b) noexcept { return _mm256_subs_epu8(a, b); }
+
+            /**
+             * input shifted up by N bytes with the end of previous shifted in
+             */
+            template <int N>
+            static type prev(const type input, const type previous) noexcept {
+                return _mm256_alignr_epi8(input, _mm256_permute2x128_si256(previous, input, 0x21), 16 - N);
+            }
+
+            static bool any(const type x) noexcept { return !_mm256_testz_si256(x, x); }
+            static bool is_ascii(const type x) noexcept { return _mm256_movemask_epi8(x) == 0; }
+        };
+        #elif defined(__SSSE3__)
+        struct utf8_vec {
+            using type = __m128i;
+            static constexpr size_t width = 16;
+
+            static type load(const void* p) noexcept { return _mm_loadu_si128(static_cast<const __m128i*>(p)); }
+            static type zero() noexcept { return _mm_setzero_si128(); }
+            static type set1(const uint8_t b) noexcept { return _mm_set1_epi8(static_cast<char>(b)); }
+            static type table(const uint8_t* t) noexcept { return load(t); }
+            static type lookup(const type t, const type index) noexcept { return _mm_shuffle_epi8(t, index); }
+            static type high_nibble(const type x) noexcept { return _mm_and_si128(_mm_srli_epi16(x, 4), set1(0x0F)); }
+            static type low_nibble(const type x) noexcept { return _mm_and_si128(x, set1(0x0F)); }
+            static type and_(const type a, const type b) noexcept { return _mm_and_si128(a, b); }
+            static type or_(const type a, const type b) noexcept { return _mm_or_si128(a, b); }
+            static type xor_(const type a, const type b) noexcept { return _mm_xor_si128(a, b); }
+            static type subs(const type a, const type b) noexcept { return _mm_subs_epu8(a, b); }
+
+            template <int N>
+            static type prev(const type input, const type previous) noexcept {
+                return _mm_alignr_epi8(input, previous, 16 - N);
+            }
+
+            static bool any(const type x) noexcept { return _mm_movemask_epi8(_mm_cmpeq_epi8(x, zero())) != 0xFFFF; }
+            static bool is_ascii(const type x) noexcept { return _mm_movemask_epi8(x) == 0; }
+        };
+        #endif
+
+        #if USYLIBPP_SIMD_LEVEL >= 2 || defined(__SSSE3__)
+        /**
+         * Keiser and Lemire, "Validating UTF-8 In Less Than One Instruction Per Byte"
+         * Three nibble lookups classify every pair of adjacent bytes, a saturating subtract checks the 3rd and 4th bytes
+         * A flagged block is rescanned with the scalar decoder, which also pins down the exact offset
+         */
+        [[nodiscard]] inline validation_result validate_blocks(const char* data, const size_t size) noexcept {
+            using V = utf8_vec;
+
+            constexpr uint8_t too_short = 1 << 0;
+            constexpr uint8_t too_long = 1 << 1;
+            constexpr uint8_t overlong_3 = 1 << 2;
+            constexpr uint8_t too_large = 1 << 3;
+            constexpr uint8_t surrogate = 1 << 4;
+            constexpr uint8_t overlong_2 = 1 << 5;
+            constexpr uint8_t too_large_1000 = 1 << 6;
+            constexpr uint8_t overlong_4 = 1 << 6;
+            constexpr uint8_t two_conts = 1 << 7;
+            constexpr uint8_t carry = too_short | too_long | two_conts;
+
+            // indexed by the high nibble of the first byte of each pair
+            static constexpr uint8_t byte_1_high[16] = {
+                too_long, too_long, too_long, too_long, too_long, too_long, too_long, too_long,
+                two_conts, two_conts, two_conts, two_conts,
+                too_short | overlong_2,
+                too_short,
+                too_short | overlong_3 | surrogate,
+                too_short | too_large | too_large_1000 | overlong_4
+            };
+
+            // indexed by the low nibble of the first byte
+            static constexpr uint8_t byte_1_low[16] = {
+                carry | overlong_3 | overlong_2 | overlong_4,
+                carry | overlong_2,
+                carry,
+                carry,
+                carry | too_large,
+                carry | too_large | too_large_1000,
+                carry | too_large | too_large_1000,
+                carry | too_large | too_large_1000,
+                carry | too_large | too_large_1000,
+                carry | too_large | too_large_1000,
+                carry | too_large | too_large_1000,
+                carry | too_large | too_large_1000,
+                carry | too_large | too_large_1000,
+                carry | too_large | too_large_1000 | surrogate,
+                carry | too_large | too_large_1000,
+                carry | too_large | too_large_1000
+            };
+
+            // indexed by the high nibble of the second byte
+            static constexpr uint8_t byte_2_high[16] = {
+                too_short, too_short, too_short, too_short, too_short, too_short, too_short, too_short,
+                too_long | overlong_2 | two_conts | overlong_3 | too_large_1000 | overlong_4,
+                too_long | overlong_2 | two_conts | overlong_3 | too_large,
+                too_long | overlong_2 | two_conts | surrogate | too_large,
+                too_long | overlong_2 | two_conts | surrogate | too_large,
+                too_short, too_short, too_short, too_short
+            };
+
+            // a block ending in one of the last three bytes of a lead that needs more bytes than remain
+            static constexpr uint8_t incomplete_max[32] = {
+                255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+                255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 0xF0 - 1, 0xE0 - 1, 0xC0 - 1
+            };
+
+            const auto table_1_high = V::table(byte_1_high);
+            const auto table_1_low = V::table(byte_1_low);
+            const auto table_2_high = V::table(byte_2_high);
+            const auto max_value = V::load(incomplete_max + 32 - V::width);
+            const auto third_byte = V::set1(0xE0 - 0x80);
+            const auto fourth_byte = V::set1(0xF0 - 0x80);
+            const auto high_bit = V::set1(0x80);
+
+            auto prev_input = V::zero();
+            auto prev_incomplete = V::zero();
+            size_t i = 0;
+            for (; i + V::width <= size; i += V::width) {
+                const auto input = V::load(data + i);
+
+                auto error = prev_incomplete;
+                if (!V::is_ascii(input)) {
+                    const auto prev1 = V::prev<1>(input, prev_input);
+                    const auto special_cases = V::and_(
+                        V::and_(V::lookup(table_1_high, V::high_nibble(prev1)), V::lookup(table_1_low, V::low_nibble(prev1))),
+                        V::lookup(table_2_high, V::high_nibble(input))
+                    );
+                    const auto must_be_continuation = V::or_(
+                        V::subs(V::prev<2>(input, prev_input), third_byte),
+                        V::subs(V::prev<3>(input, prev_input), fourth_byte)
+                    );
+                    error = V::xor_(V::and_(must_be_continuation, high_bit), special_cases);
+                    prev_incomplete = V::subs(input, max_value);
+                }
+
+                if (V::any(error)) return validate_scalar(data, size, sequence_start(data, i));
+                prev_input = input;
+            }
+
+            // the tail, and any sequence the last block left open
+            return validate_scalar(data, size, sequence_start(data, i));
+        }
+        #endif
+    }
+
+    /**
+     * Checks str is well formed UTF-8: no overlong forms, surrogates, values past U+10FFFF or truncated sequences
+     * Vectorised with AVX2 or SSSE3 when the translation unit enables them, scalar with an SSE2 ASCII skip otherwise
+     */
+    [[nodiscard]] inline validation_result validate_utf8(const std::string_view str) noexcept {
+        #if USYLIBPP_SIMD_LEVEL >= 2 || defined(__SSSE3__)
+        return internal::validate_blocks(str.data(), str.size());
+        #else
+        return internal::validate_scalar(str.data(), str.size(), 0);
+        #endif
+    }
+
+    /**
+     * Assumes str is valid UTF-8, every byte that is not a continuation byte starts a code point
+     */
+    [[nodiscard]] inline size_t count_code_points(const std::string_view str) noexcept {
+        return str.size() - simd::count_continuation(str.data(), str.size());
+    }
+
+    /**
+     * Validates input that arrives in chunks, sequences split across chunk boundaries are carried over
+     * Error offsets count from the start of the first chunk
+     */
+    class utf8_validator {
+    private:
+        size_t position = 0;
+        size_t pending_offset = 0;
+        char pending[4]{};
+        size_t pending_size = 0;
+        bool failed = false;
+        size_t error_offset = 0;
+
+        [[nodiscard]] static size_t sequence_length(const unsigned char lead) noexcept {
+            return lead < 0xC0 ? 0 : lead < 0xE0 ? 2 : lead < 0xF0 ? 3 : lead < 0xF8 ? 4 : 0;
+        }
+
+        bool fail(const size_t offset) noexcept {
+            failed = true;
+            error_offset = offset;
+            return false;
+        }
+    public:
+        /**
+         * Returns false once an error has been found, later chunks are ignored
+         */
+        bool feed(const std::string_view chunk) noexcept {
+            if (failed) return false;
+            const auto base = position;
+            position += chunk.size();
+            size_t start = 0;
+
+            if (pending_size > 0) {
+                const auto needed = sequence_length(static_cast<unsigned char>(pending[0]));
+                while (pending_size < needed && start < chunk.size()) pending[pending_size++] = chunk[start++];
+                if (pending_size < needed) return true;
+
+                char32_t c = 0;
+                if (decode_utf8(pending, pending_size, c) != pending_size) return fail(pending_offset);
+                pending_size = 0;
+            }
+
+            // hold back a sequence cut off by the end of the chunk
+            auto end = chunk.size();
+            for (size_t back = 1; back <= 3 && back <= end - start; ++back) {
+                const auto b = static_cast<unsigned char>(chunk[end - back]);
+                if ((b & 0xC0) != 0x80) {
+                    if (sequence_length(b) > back) end -= back;
+                    break;
+                }
+            }
+
+            const auto result = validate_utf8(chunk.substr(start, end - start));
+            if (!result) return fail(base + start + result.error_offset);
+
+            pending_offset = base + end;
+            pending_size = chunk.size() - end;
+            std::memcpy(pending, chunk.data() + end, pending_size);
+            return true;
+        }
+
+        /**
+         * Call once the input has ended, a sequence still waiting for bytes counts as an error
+         */
+        [[nodiscard]] validation_result finish() const noexcept {
+            if (failed) return {false, error_offset};
+            if (pending_size > 0) return {false, pending_offset};
+            return {true, position};
+        }
+
+        void reset() noexcept {
+            *this = utf8_validator{};
+        }
+    };
+}
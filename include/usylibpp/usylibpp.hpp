@@ -4,9 +4,12 @@
 #include "windows.hpp"
 #endif
 
+#include "parallel.hpp"
 #include "strings.hpp"
+#include "unicode.hpp"
 #include "files.hpp"
 #include "init.hpp"
 #include "time.hpp"
 #include "print.hpp"
+#include "log.hpp"
 #include <usylibppconfig.hpp>
\ No newline at end of file
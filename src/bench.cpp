@@ -0,0 +1,639 @@
+#include <usylibpp/usylibpp.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/**
+ * Microbenchmarks for the library against the obvious standard library way of doing the same thing
+ * Inputs come from a fixed seed so runs are comparable, every case is swept over several input sizes
+ *
+ * usylibpp_bench [--quick] [--filter text] [--seed n] [--min-time ms] [--json path]
+ */
+namespace {
+    using namespace usylibpp;
+    using bench_clock = std::chrono::steady_clock;
+
+    struct config {
+        uint64_t seed = 42;
+        double min_time_ms = 20;
+        bool quick = false;
+        std::string filter;
+        std::string json_path;
+    };
+
+    struct result {
+        std::string group;
+        std::string name;
+        std::string variant;
+        size_t size;
+        double ns_per_op;
+        double bytes_per_second;
+    };
+
+    /**
+     * Appends text as a quoted JSON string, escaping quotes, backslashes and control characters
+     */
+    void append_json_string(std::string& out, const std::string_view text) {
+        out += '"';
+        for (const char c : text) {
+            if (c == '"' || c == '\\') {
+                out += '\\';
+                out += c;
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                constexpr std::string_view hex = "0123456789abcdef";
+                out += "\\u00";
+                out += hex[static_cast<unsigned char>(c) >> 4];
+                out += hex[c & 0xf];
+            } else {
+                out += c;
+            }
+        }
+        out += '"';
+    }
+
+    /**
+     * Stops the optimiser from deleting work whose result is never used
+     */
+    template <typename T>
+    inline void keep(const T& value) {
+        #if defined(__GNUC__) || defined(__clang__)
+        asm volatile("" : : "r,m"(value) : "memory");
+        #else
+        static const void* volatile sink;
+        sink = &value;
+        #endif
+    }
+
+    [[nodiscard]] std::string format_size(const size_t size) {
+        if (size == 0) return "";
+        if (size >= 1024 * 1024) return strings::concat_strings(strings::to_small_string(size / (1024 * 1024)).view(), "MiB");
+        if (size >= 1024) return strings::concat_strings(strings::to_small_string(size / 1024).view(), "KiB");
+        return strings::concat_strings(strings::to_small_string(size).view(), "B");
+    }
+
+    class runner {
+    private:
+        config cfg;
+        std::vector<result> results;
+    public:
+        explicit runner(config cfg) : cfg(std::move(cfg)) {}
+
+        [[nodiscard]] const config& settings() const noexcept {
+            return cfg;
+        }
+
+        /**
+         * Whether --filter lets this case run
+         */
+        [[nodiscard]] bool selected(const std::string_view group, const std::string_view name, const std::string_view variant) const {
+            return cfg.filter.empty() || strings::concat_strings(group, "/", name, "/", variant).find(cfg.filter) != std::string::npos;
+        }
+
+        [[nodiscard]] std::vector<size_t> sizes() const {
+            if (cfg.quick) return {4 * 1024, 1024 * 1024};
+            return {64, 4 * 1024, 256 * 1024, 4 * 1024 * 1024};
+        }
+
+        /**
+         * Doubles the iteration count until one batch takes a fifth of min_time, then reports the median of five batches
+         * size labels the input, bytes is how much of it one call of f processes, 0 leaves either column empty
+         */
+        template <typename F>
+        void run(const std::string_view group, const std::string_view name, const std::string_view variant, const size_t size, const size_t bytes, F&& f) {
+            if (!selected(group, name, variant)) return;
+
+            const auto batch_time = std::chrono::duration<double, std::milli>(cfg.min_time_ms / 5);
+            const auto time_batch = [&](const size_t iterations) {
+                const auto start = bench_clock::now();
+                for (size_t i = 0; i < iterations; ++i) f();
+                return bench_clock::now() - start;
+            };
+
+            f();
+            size_t iterations = 1;
+            while (time_batch(iterations) < batch_time && iterations < (size_t{1} << 30)) iterations *= 2;
+
+            std::array<double, 5> samples{};
+            for (auto& sample : samples) {
+                sample = std::chrono::duration<double, std::nano>(time_batch(iterations)).count() / static_cast<double>(iterations);
+            }
+            std::sort(samples.begin(), samples.end());
+            const auto ns = samples[samples.size() / 2];
+            const auto throughput = bytes == 0 ? 0.0 : static_cast<double>(bytes) / ns * 1e9;
+
+            results.push_back({std::string{group}, std::string{name}, std::string{variant}, size, ns, throughput});
+            if (bytes == 0) {
+                print::println("{:<10} {:<28} {:<16} {:>8} {:>14.1f} ns/op", group, name, variant, format_size(size), ns);
+            } else {
+                print::println("{:<10} {:<28} {:<16} {:>8} {:>14.1f} ns/op {:>10.1f} MB/s", group, name, variant, format_size(size), ns, throughput / 1e6);
+            }
+        }
+
+        [[nodiscard]] bool write_json() const {
+            std::string json = "[\n";
+            for (size_t i = 0; i < results.size(); ++i) {
+                const auto& r = results[i];
+                json += "  {\"group\": ";
+                append_json_string(json, r.group);
+                json += ", \"name\": ";
+                append_json_string(json, r.name);
+                json += ", \"variant\": ";
+                append_json_string(json, r.variant);
+                strings::concat_into(json,
+                    ", \"size\": ", strings::to_small_string(r.size).view(),
+                    ", \"ns_per_op\": ", strings::to_small_string(r.ns_per_op).view(),
+                    ", \"bytes_per_second\": ", strings::to_small_string(r.bytes_per_second).view(),
+                    i + 1 < results.size() ? "},\n" : "}\n"
+                );
+            }
+            json += "]\n";
+            return files::write_atomic(cfg.json_path, json, files::sync_mode::none);
+        }
+    };
+
+    [[nodiscard]] std::string random_text(std::mt19937_64& rng, const size_t size, const std::string_view alphabet) {
+        std::string text(size, '\0');
+        std::uniform_int_distribution<size_t> pick{0, alphabet.size() - 1};
+        for (auto& c : text) c = alphabet[pick(rng)];
+        return text;
+    }
+
+    /**
+     * Fields of random length around mean_length separated by delimiter
+     */
+    [[nodiscard]] std::string random_fields(std::mt19937_64& rng, const size_t size, const size_t mean_length, const char delimiter) {
+        std::string text = random_text(rng, size, "abcdefghijklmnopqrstuvwxyz0123456789");
+        std::uniform_int_distribution<size_t> gap{1, mean_length * 2};
+        for (size_t i = gap(rng); i < text.size(); i += gap(rng)) text[i] = delimiter;
+        return text;
+    }
+
+    constexpr std::string_view lower_alnum = "abcdefghijklmnopqrstuvwxyz0123456789";
+    constexpr std::string_view mixed_case = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789 ";
+
+    void bench_split(runner& bench, std::mt19937_64& rng) {
+        for (const auto size : bench.sizes()) {
+            for (const auto& [variant, mean] : {std::pair{"short fields", size_t{8}}, std::pair{"long fields", size_t{80}}}) {
+                const auto text = random_fields(rng, size, mean, ',');
+
+                bench.run("strings", "split_by_for_each", variant, size, size, [&] {
+                    size_t total = 0;
+                    strings::split_by_for_each(text, ',', [&](const std::string_view field) { total += field.size(); });
+                    keep(total);
+                });
+
+                bench.run("strings", "split (find loop)", variant, size, size, [&] {
+                    size_t total = 0;
+                    const std::string_view input = text;
+                    size_t start = 0;
+                    for (auto end = input.find(','); end != std::string_view::npos; end = input.find(',', start)) {
+                        total += end - start;
+                        start = end + 1;
+                    }
+                    total += input.size() - start;
+                    keep(total);
+                });
+            }
+
+            const auto text = random_fields(rng, size, 16, ',');
+            bench.run("strings", "count_of", "", size, size, [&] { keep(strings::count_of(text, ',')); });
+            bench.run("strings", "count_of (std::count)", "", size, size, [&] { keep(std::count(text.begin(), text.end(), ',')); });
+        }
+    }
+
+    void bench_replace(runner& bench, std::mt19937_64& rng) {
+        for (const auto size : bench.sizes()) {
+            for (const auto& [variant, spacing] : {std::pair{"sparse", size_t{1024}}, std::pair{"dense", size_t{16}}}) {
+                auto text = random_text(rng, size, lower_alnum);
+                for (size_t i = 0; i + 4 <= text.size(); i += spacing) text.replace(i, 4, "{id}");
+
+                bench.run("strings", "replace_all", variant, size, size, [&] { keep(strings::replace_all(text, "{id}", "value")); });
+
+                strings::arena arena;
+                bench.run("strings", "replace_all (arena)", variant, size, size, [&] {
+                    keep(strings::replace_all(arena, text, "{id}", "value"));
+                    arena.reset();
+                });
+
+                // find + replace in place moves the tail on every match, quadratic on big dense inputs
+                if (size > 256 * 1024 && spacing < 1024) continue;
+                bench.run("strings", "replace_all (find/replace)", variant, size, size, [&] {
+                    std::string result{text};
+                    for (auto pos = result.find("{id}"); pos != std::string::npos; pos = result.find("{id}", pos + 5)) result.replace(pos, 4, "value");
+                    keep(result);
+                });
+            }
+        }
+    }
+
+    void bench_case(runner& bench, std::mt19937_64& rng) {
+        for (const auto size : bench.sizes()) {
+            const auto text = random_text(rng, size, mixed_case);
+
+            bench.run("strings", "to_lowercase", "ascii", size, size, [&] { keep(strings::to_lowercase(text)); });
+            bench.run("strings", "to_lowercase (transform)", "ascii", size, size, [&] {
+                std::string result{text};
+                std::transform(result.begin(), result.end(), result.begin(), [](const unsigned char c) { return static_cast<char>(std::tolower(c)); });
+                keep(result);
+            });
+        }
+    }
+
+    void bench_url(runner& bench, std::mt19937_64& rng) {
+        for (const auto size : bench.sizes()) {
+            for (const auto& [variant, alphabet] : {std::pair{"safe", lower_alnum}, std::pair{"mixed", std::string_view{"abcdefgh0123 /?&=%#"}}}) {
+                const auto text = random_text(rng, size, alphabet);
+
+                bench.run("strings", "url_encode", variant, size, size, [&] { keep(strings::url_encode(text)); });
+                bench.run("strings", "url_encode (ostringstream)", variant, size, size, [&] {
+                    std::ostringstream out;
+                    out << std::hex << std::uppercase << std::setfill('0');
+                    for (const unsigned char c : text) {
+                        if (std::isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~') out << c;
+                        else out << '%' << std::setw(2) << static_cast<int>(c);
+                    }
+                    keep(out.str());
+                });
+
+                const auto encoded = strings::url_encode(text);
+                bench.run("strings", "url_decode", variant, size, encoded.size(), [&] { keep(strings::url_decode(encoded)); });
+            }
+        }
+    }
+
+    void bench_numbers(runner& bench, std::mt19937_64& rng) {
+        constexpr size_t count = 1024;
+
+        std::vector<std::string> integers;
+        std::uniform_int_distribution<long long> integer{-1'000'000'000'000, 1'000'000'000'000};
+        for (size_t i = 0; i < count; ++i) integers.emplace_back(strings::to_small_string(integer(rng)).view());
+
+        std::vector<std::string> doubles;
+        std::uniform_real_distribution<double> real{-1e6, 1e6};
+        for (size_t i = 0; i < count; ++i) doubles.emplace_back(strings::to_small_string(real(rng)).view());
+
+        for (const auto& [variant, values] : {std::pair{"integers", &integers}, std::pair{"doubles", &doubles}}) {
+            size_t bytes = 0;
+            for (const auto& value : *values) bytes += value.size();
+            const bool is_integer = values == &integers;
+
+            bench.run("strings", "to_number", variant, bytes, bytes, [&] {
+                double total = 0;
+                for (const auto& value : *values) total += is_integer ? static_cast<double>(*strings::to_number<long long>(value)) : *strings::to_number<double>(value);
+                keep(total);
+            });
+
+            bench.run("strings", "to_number (stoll/stod)", variant, bytes, bytes, [&] {
+                double total = 0;
+                for (const auto& value : *values) total += is_integer ? static_cast<double>(std::stoll(value)) : std::stod(value);
+                keep(total);
+            });
+        }
+
+        std::vector<long long> numbers;
+        for (size_t i = 0; i < count; ++i) numbers.push_back(integer(rng));
+
+        bench.run("strings", "to_small_string", "1024 integers", 0, 0, [&] {
+            for (const auto n : numbers) keep(strings::to_small_string(n));
+        });
+        bench.run("strings", "to_string_view", "1024 integers", 0, 0, [&] {
+            for (const auto n : numbers) keep(strings::to_string_view(n));
+        });
+        bench.run("strings", "to_string (std)", "1024 integers", 0, 0, [&] {
+            for (const auto n : numbers) keep(std::to_string(n));
+        });
+    }
+
+    void bench_concat(runner& bench, std::mt19937_64& rng) {
+        for (const auto& [variant, parts, length] : {std::tuple{"3 x 16B", size_t{3}, size_t{16}}, std::tuple{"8 x 64B", size_t{8}, size_t{64}}}) {
+            std::vector<std::string> p;
+            for (size_t i = 0; i < 8; ++i) p.push_back(random_text(rng, length, lower_alnum));
+            const auto bytes = parts * length;
+
+            if (parts == 3) {
+                bench.run("strings", "concat_strings", variant, bytes, bytes, [&] { keep(strings::concat_strings(p[0], p[1], p[2])); });
+                bench.run("strings", "concat (operator+)", variant, bytes, bytes, [&] { keep(p[0] + p[1] + p[2]); });
+
+                std::string out;
+                bench.run("strings", "concat_into (reused)", variant, bytes, bytes, [&] {
+                    out.clear();
+                    strings::concat_into(out, p[0], p[1], p[2]);
+                    keep(out);
+                });
+            } else {
+                bench.run("strings", "concat_strings", variant, bytes, bytes, [&] { keep(strings::concat_strings(p[0], p[1], p[2], p[3], p[4], p[5], p[6], p[7])); });
+                bench.run("strings", "concat (operator+)", variant, bytes, bytes, [&] { keep(p[0] + p[1] + p[2] + p[3] + p[4] + p[5] + p[6] + p[7]); });
+
+                std::string out;
+                bench.run("strings", "concat_into (reused)", variant, bytes, bytes, [&] {
+                    out.clear();
+                    strings::concat_into(out, p[0], p[1], p[2], p[3], p[4], p[5], p[6], p[7]);
+                    keep(out);
+                });
+            }
+        }
+    }
+
+    void bench_hash(runner& bench, std::mt19937_64& rng) {
+        for (const auto size : bench.sizes()) {
+            const auto text = random_text(rng, size, lower_alnum);
+            bench.run("strings", "hash", "", size, size, [&] { keep(strings::hash(text)); });
+            bench.run("strings", "hash (std::hash)", "", size, size, [&] { keep(std::hash<std::string_view>{}(text)); });
+        }
+
+        for (const size_t count : {size_t{1000}, size_t{100000}}) {
+            std::vector<std::string> keys;
+            for (size_t i = 0; i < count; ++i) keys.push_back(random_text(rng, 8 + rng() % 24, lower_alnum));
+
+            constexpr size_t lookups = 1000;
+            std::vector<std::string_view> queries;
+            for (size_t i = 0; i < lookups; ++i) queries.push_back(keys[rng() % keys.size()]);
+
+            strings::flat_map<size_t> flat;
+            std::unordered_map<std::string, size_t> node;
+            std::unordered_map<std::string, size_t, strings::string_hash, std::equal_to<>> transparent;
+            for (size_t i = 0; i < keys.size(); ++i) {
+                flat.try_emplace(keys[i], i);
+                node.emplace(keys[i], i);
+                transparent.emplace(keys[i], i);
+            }
+
+            const auto variant = strings::concat_strings(strings::to_small_string(count).view(), " keys, 1000 lookups");
+            bench.run("strings", "flat_map::find", variant, 0, 0, [&] {
+                size_t total = 0;
+                for (const auto key : queries) total += *flat.find(key);
+                keep(total);
+            });
+            bench.run("strings", "unordered_map::find", variant, 0, 0, [&] {
+                size_t total = 0;
+                for (const auto key : queries) total += node.find(std::string{key})->second;
+                keep(total);
+            });
+            bench.run("strings", "unordered_map (string_hash)", variant, 0, 0, [&] {
+                size_t total = 0;
+                for (const auto key : queries) total += transparent.find(key)->second;
+                keep(total);
+            });
+        }
+    }
+
+    /**
+     * Field names with heavy repetition, as parsed out of log lines
+     */
+    void bench_intern(runner& bench, std::mt19937_64& rng) {
+        std::vector<std::string> names;
+        for (size_t i = 0; i < 500; ++i) names.push_back(random_text(rng, 6 + rng() % 20, lower_alnum));
+        std::vector<std::string_view> fields;
+        std::geometric_distribution<size_t> popular{0.02};
+        for (size_t i = 0; i < 10000; ++i) fields.push_back(names[std::min(popular(rng), names.size() - 1)]);
+
+        size_t bytes = 0;
+        for (const auto field : fields) bytes += field.size();
+
+        bench.run("strings", "intern_pool::intern", "10000 fields", bytes, bytes, [&] {
+            strings::intern_pool pool;
+            for (const auto field : fields) keep(pool.intern(field));
+        });
+        bench.run("strings", "concurrent_intern_pool", "10000 fields", bytes, bytes, [&] {
+            strings::concurrent_intern_pool pool;
+            for (const auto field : fields) keep(pool.intern(field));
+        });
+        bench.run("strings", "intern (unordered_set)", "10000 fields", bytes, bytes, [&] {
+            std::unordered_set<std::string> pool;
+            for (const auto field : fields) keep(*pool.emplace(field).first);
+        });
+        bench.run("strings", "no interning (vector)", "10000 fields", bytes, bytes, [&] {
+            std::vector<std::string> copies;
+            for (const auto field : fields) copies.emplace_back(field);
+            keep(copies);
+        });
+    }
+
+    void bench_unicode(runner& bench, std::mt19937_64& rng) {
+        constexpr std::string_view words[] = {"plain ", "ascii ", "wörter ", "ПРИВЕТ ", "😀 ", "συνάρτηση ", "日本語 "};
+        std::uniform_int_distribution<size_t> pick{0, std::size(words) - 1};
+
+        for (const auto size : bench.sizes()) {
+            std::string text;
+            while (text.size() < size) text += words[pick(rng)];
+
+            bench.run("unicode", "validate_utf8", "mixed", text.size(), text.size(), [&] { keep(unicode::validate_utf8(text)); });
+            bench.run("unicode", "validate_utf8 (decode loop)", "mixed", text.size(), text.size(), [&] {
+                bool valid = true;
+                for (size_t i = 0; valid && i < text.size();) {
+                    char32_t c = 0;
+                    const auto length = unicode::decode_utf8(text.data() + i, text.size() - i, c);
+                    valid = length != 0;
+                    i += length;
+                }
+                keep(valid);
+            });
+            bench.run("unicode", "to_utf16", "mixed", text.size(), text.size(), [&] { keep(unicode::to_utf16(text)); });
+        }
+    }
+
+    void bench_files(runner& bench, std::mt19937_64& rng) {
+        const auto directory = std::filesystem::temp_directory_path() / "usylibpp_bench";
+        std::filesystem::create_directories(directory);
+
+        const std::vector<size_t> file_sizes = bench.settings().quick
+            ? std::vector<size_t>{4 * 1024, 1024 * 1024}
+            : std::vector<size_t>{4 * 1024, 1024 * 1024, 16 * 1024 * 1024};
+
+        for (const auto size : file_sizes) {
+            const auto path = directory / "read.bin";
+            if (!files::write_atomic(path, random_text(rng, size, lower_alnum), files::sync_mode::none)) continue;
+
+            bench.run("files", "read_as_bytes", "", size, size, [&] { keep(files::read_as_bytes(path)); });
+            bench.run("files", "read (istreambuf_iterator)", "", size, size, [&] {
+                std::ifstream file(path, std::ios::binary);
+                keep(std::string{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}});
+            });
+            bench.run("files", "mapped_file + count_of", "", size, size, [&] {
+                const auto mapped = files::mapped_file::open(path, files::access_hint::sequential);
+                keep(strings::count_of(mapped->view(), '\n'));
+            });
+        }
+
+        constexpr size_t record_size = 4000;
+        const size_t total = bench.settings().quick ? 4 * 1024 * 1024 : 64 * 1024 * 1024;
+        const auto record = random_text(rng, record_size, lower_alnum);
+        const auto path = directory / "write.bin";
+
+        bench.run("files", "writer", "4KB records", total, total, [&] {
+            auto out = files::writer::open(path);
+            for (size_t written = 0; written < total; written += record_size) out->write(record);
+            keep(out->close());
+        });
+        // tmpfs and some other file systems refuse O_DIRECT, the writer then quietly buffers and the row would be a second buffered run
+        // two records fill a block, so the probe also sees file systems that only refuse the write
+        const auto direct = [&] {
+            auto probe = files::writer::open(path, {.buffer_size = record_size, .direct = true});
+            return probe && probe->write(record) && probe->write(record) && probe->flush() && probe->is_direct();
+        };
+        if (bench.selected("files", "writer (O_DIRECT)", "4KB records")) {
+            if (direct()) {
+                bench.run("files", "writer (O_DIRECT)", "4KB records", total, total, [&] {
+                    auto out = files::writer::open(path, {.direct = true});
+                    for (size_t written = 0; written < total; written += record_size) out->write(record);
+                    keep(out->close());
+                });
+            } else {
+                print::println("{:<10} {:<28} skipped, {} does not support O_DIRECT", "files", "writer (O_DIRECT)", directory.string());
+            }
+        }
+        bench.run("files", "ofstream", "4KB records", total, total, [&] {
+            std::ofstream out(path, std::ios::binary | std::ios::trunc);
+            for (size_t written = 0; written < total; written += record_size) out.write(record.data(), record_size);
+        });
+
+        std::error_code ec;
+        std::filesystem::remove_all(directory, ec);
+    }
+
+    void bench_print(runner& bench) {
+        #ifdef WIN32
+        constexpr auto null_device = "NUL";
+        #else
+        constexpr auto null_device = "/dev/null";
+        #endif
+
+        std::FILE* sink = std::fopen(null_device, "wb");
+        if (!sink) return;
+        std::ofstream stream(null_device, std::ios::binary);
+
+        constexpr size_t lines = 1000;
+        const std::string_view name = "request";
+
+        bench.run("print", "println(FILE*)", "1000 lines", 0, 0, [&] {
+            for (size_t i = 0; i < lines; ++i) print::println(sink, "{} number {} done", name, i);
+        });
+        bench.run("print", "fprintf", "1000 lines", 0, 0, [&] {
+            for (size_t i = 0; i < lines; ++i) std::fprintf(sink, "%.*s number %zu done\n", static_cast<int>(name.size()), name.data(), i);
+        });
+        bench.run("print", "ostream <<", "1000 lines", 0, 0, [&] {
+            for (size_t i = 0; i < lines; ++i) stream << name << " number " << i << " done" << '\n';
+        });
+
+        std::fclose(sink);
+    }
+
+    /**
+     * Same work on pools of 1 to N threads, against starting a thread per chunk
+     */
+    void bench_parallel(runner& bench, std::mt19937_64& rng) {
+        const size_t size = bench.settings().quick ? 1024 * 1024 : 16 * 1024 * 1024;
+        const auto text = random_fields(rng, size, 16, '\n');
+        const auto hardware = std::max(1u, std::thread::hardware_concurrency());
+
+        std::vector<size_t> thread_counts;
+        for (size_t threads = 1; threads < hardware; threads *= 2) thread_counts.push_back(threads);
+        thread_counts.push_back(hardware);
+
+        for (const auto threads : thread_counts) {
+            const auto variant = strings::concat_strings(strings::to_small_string(threads).view(), " threads");
+            parallel::thread_pool pool{{.threads = threads}};
+
+            bench.run("parallel", "for_each_chunk", variant, size, size, [&] {
+                std::atomic<size_t> total{0};
+                parallel::for_each_chunk(text, '\n', [&](const std::string_view chunk) { total += strings::count_of(chunk, ','); }, threads, pool);
+                keep(total.load());
+            });
+
+            bench.run("parallel", "for_each_chunk (jthreads)", variant, size, size, [&] {
+                std::atomic<size_t> total{0};
+                const auto chunks = parallel::split_chunks(text, parallel::chunk_count(text.size(), threads));
+                {
+                    std::vector<std::jthread> workers;
+                    for (const auto chunk : chunks) workers.emplace_back([&total, chunk] { total += strings::count_of(chunk, ','); });
+                }
+                keep(total.load());
+            });
+
+            constexpr size_t tasks = 1000;
+            bench.run("parallel", "task_group", strings::concat_strings(variant, ", 1000 tasks"), 0, 0, [&] {
+                std::atomic<size_t> done{0};
+                parallel::task_group group{pool};
+                for (size_t i = 0; i < tasks; ++i) group.run([&done] { ++done; });
+                group.wait();
+                keep(done.load());
+            });
+        }
+
+        bench.run("parallel", "jthread per task", "1000 tasks", 0, 0, [&] {
+            std::atomic<size_t> done{0};
+            for (size_t i = 0; i < 1000; ++i) std::jthread{[&done] { ++done; }};
+            keep(done.load());
+        });
+    }
+
+    [[nodiscard]] std::optional<config> parse_args(const int argc, char** argv) {
+        config cfg;
+        for (int i = 1; i < argc; ++i) {
+            const std::string_view arg = argv[i];
+            const bool has_value = i + 1 < argc;
+            if (arg == "--quick") cfg.quick = true;
+            else if (arg == "--filter" && has_value) cfg.filter = argv[++i];
+            else if (arg == "--json" && has_value) cfg.json_path = argv[++i];
+            else if (arg == "--seed" && has_value) {
+                const auto seed = strings::to_number<uint64_t>(argv[++i]);
+                if (!seed) return std::nullopt;
+                cfg.seed = *seed;
+            } else if (arg == "--min-time" && has_value) {
+                const auto ms = strings::to_number<double>(argv[++i]);
+                if (!ms || *ms <= 0) return std::nullopt;
+                cfg.min_time_ms = *ms;
+            } else {
+                return std::nullopt;
+            }
+        }
+        return cfg;
+    }
+}
+
+int main(int argc, char** argv) {
+    const auto cfg = parse_args(argc, argv);
+    if (!cfg) {
+        print::println(stderr, "usage: usylibpp_bench [--quick] [--filter text] [--seed n] [--min-time ms] [--json path]");
+        return 1;
+    }
+
+    print::println("usylibpp {} benchmarks, seed {}, simd level {}", info::version, cfg->seed, USYLIBPP_SIMD_LEVEL);
+
+    runner bench{*cfg};
+    std::mt19937_64 rng{cfg->seed};
+
+    bench_split(bench, rng);
+    bench_replace(bench, rng);
+    bench_case(bench, rng);
+    bench_url(bench, rng);
+    bench_numbers(bench, rng);
+    bench_concat(bench, rng);
+    bench_hash(bench, rng);
+    bench_intern(bench, rng);
+    bench_unicode(bench, rng);
+    bench_files(bench, rng);
+    bench_print(bench);
+    bench_parallel(bench, rng);
+
+    if (!cfg->json_path.empty() && !bench.write_json()) {
+        print::println(stderr, "could not write {}", cfg->json_path);
+        return 1;
+    }
+    return 0;
+}
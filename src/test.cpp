@@ -7,27 +7,112 @@ int main() {
 
     print::println("Time functions:");
     print::println("time::datetime_string: {}", time::datetime_string());
+    {
+        static const time::timer timer{"test.datetime_string"};
+        for (int i = 0; i < 1000; ++i) {
+            time::scoped_timer scope{timer};
+            (void) time::datetime_string();
+        }
+        print::println("time::dump:");
+        time::dump();
+    }
     print::println();
 
     print::println("String functions:");
     print::println("strings::concat_strings (chars): {}", strings::concat_strings("hello", " ", "there!"));
     print::println(L"strings::concat_strings (wide chars): {}", strings::concat_strings(L"hello", L" ", L"there!"));
+    print::println("strings::concat_v (compile time): {}", strings::concat_v<"hello", " ", "there!">.view());
     {
         auto str = "THis IS moSTLY upperCASE";
         print::println("strings::to_lowercase before: {}, after: {}", str, strings::to_lowercase(str));
     }
+    {
+        auto str = "ÀÉÎ ΣΑΣ ПРИВЕТ";
+        print::println("strings::to_lowercase<utf8> before: {}, after: {}", str, strings::to_lowercase<strings::case_mode::utf8>(str));
+    }
     {
         auto str = "this has THIS STrING and once again THIS STrING";
         print::println("strings::replace_all before: {}, after: {}", str, strings::replace_all(str, "THIS STrING", "not that string"));
     }
     print::println("strings::to_number<size_t> {}", *strings::to_number<size_t>("1234567"));
+    print::println("strings::to_number<double> {}", *strings::to_number<double>("-1.5e3"));
+    print::println("strings::to_number<int> (hex) {}", *strings::to_number<int>("ff", 16));
     print::println("strings::to_string_view {}", *strings::to_string_view(12234ULL));
+    print::println("strings::to_string_view (hex) {}", *strings::to_string_view(-255, 16));
+    print::println("strings::to_small_string {} {}", strings::to_small_string(1.25), strings::to_small_string(255, 2));
+    print::println("strings::hash(\"hello\"): {:016x}", strings::hash("hello"));
+    {
+        strings::flat_map<int> counts;
+        strings::split_by_for_each("get,put,get,delete,get", ',', [&](const std::string_view field) { ++counts[field]; });
+        print::println("strings::flat_map counts: get {} put {} patch {}", *counts.find("get"), *counts.find("put"), counts.contains("patch"));
+    }
+    {
+        strings::intern_pool pool;
+        const auto first = pool.intern("example.com");
+        const auto second = pool.intern(strings::concat_strings("example", ".com"));
+        print::println("strings::intern_pool: same handle {} text {} stored bytes {}", first == second, pool.view(first), pool.stats().stored_bytes);
+    }
+    {
+        strings::concurrent_intern_pool pool{1, 2};
+        const auto a = pool.intern("a");
+        (void) pool.intern("b");
+        bool full = false;
+        try {
+            (void) pool.intern("c");
+        } catch (const std::length_error&) {
+            full = true;
+        }
+        print::println("strings::concurrent_intern_pool: full shard throws {}, existing still found {}, max per shard with 16 shards {}",
+            full, pool.intern("a") == a, strings::concurrent_intern_pool{16}.max_per_shard());
+    }
+    print::println("strings::parallel_reduce_lines any empty line: {}", strings::parallel_reduce_lines("a\n\nb", false,
+        [](bool& acc, const std::string_view line) { acc = acc || line.empty(); },
+        [](bool& total, bool&& acc) { total = total || acc; }));
+    print::println("strings::parse_column<double> size {}", strings::parse_column<double>("1.5, 2, -3e2, 4")->size());
     {
         auto str = "?this_is_a_get=lol a space??&ts=!!!%";
         print::println("strings::url_encode before: {}, after: {}", str, strings::url_encode(str));
+        print::println("strings::url_decode round trip: {}", *strings::url_decode(strings::url_encode(str)));
+        const bool rejected = !strings::url_decode(std::string(100, 'a') + std::string(40, '%')) && !strings::url_decode("a%G1")
+            && !strings::url_decode("a%") && !strings::url_decode("a%4");
+        print::println("strings::url_decode rejects malformed escapes: {}", rejected);
+    }
+    {
+        strings::arena arena;
+        const auto joined = strings::concat_strings(arena, "hello", " ", "arena");
+        print::println("strings::arena {} ({} bytes used)", strings::replace_all(arena, joined, "arena", "there!"), arena.bytes_used());
+    }
+    print::println();
+
+    print::println("Unicode functions:");
+    {
+        auto str = "ÀÉÎ ΣΑΣ 😀";
+        print::println("unicode::utf16_length {}, utf32_length {}", *unicode::utf16_length(str), *unicode::utf32_length(str));
+        print::println("unicode::to_utf16 round trip: {}", *unicode::to_utf8(*unicode::to_utf16(str)));
+        print::println(stdout, L"unicode::to_wstring: {}", *unicode::to_wstring(str));
+        print::println("unicode::validate_utf8 {}, count_code_points {}", static_cast<bool>(unicode::validate_utf8(str)), unicode::count_code_points(str));
+        print::println("unicode::validate_utf8 error offset {}", unicode::validate_utf8("ok\xC0\x80").error_offset);
     }
     print::println();
 
+    print::println("Parallel functions:");
+    print::println("parallel::default_pool().size(): {}", parallel::default_pool().size());
+    print::println("parallel::parallel_reduce sum of 0..1000000: {}", parallel::parallel_reduce(size_t{0}, size_t{1000001}, uint64_t{0},
+        [](uint64_t& acc, const size_t i) { acc += i; }, [](uint64_t& total, uint64_t&& acc) { total += acc; }, 4096));
+    {
+        std::promise<void> posted;
+        const auto signal = [&posted] { posted.set_value(); };
+        parallel::default_pool().post(signal);
+        posted.get_future().wait();
+        print::println("parallel::thread_pool::post (named lambda) ran");
+    }
+    print::println();
+
+    print::println("Log functions:");
+    log::info("log::info written from the background writer thread");
+    log::default_logger().flush();
+    print::println();
+
     #ifdef WIN32
     print::println("Windows functions:");
     // These break the vscode terminal